@@ -1,5 +1,6 @@
 #include "common.h"
 #include "common/logging.h"
+#include "common/palette.h"
 
 void print_help()
 {
@@ -7,18 +8,34 @@ void print_help()
     LOG("----------------------------------------");
     LOG("  -od, --output_disk       [opt filename]         Save output image to disk. Defaults to 'output.png' if no filename is provided.");
     LOG("  -on, --output_network    [opt IP [opt port]]    Send output image over TCP. Defaults to IP 0.0.0.0 and port 5001 if not specified.");
+    LOG("  -of, --output_field      [opt filename]         Save the smoothed iteration values of the samples instead of colors. Defaults to 'output.field'");
     LOG("  -w,  --width             <int>                  Image width in pixels");
     LOG("  -h,  --height            <int>                  Image height in pixels");
     LOG("  -s,  --samples           <int>                  Number of MSAA samples. Must be a perfect square number");
-    LOG("  -b,  --block_size        <int>                  Size in pixels of the MPI image task");
+    LOG("  -as, --adaptive_samples  <int>                  Max samples of the pixels refined by adaptive anti-aliasing. Replaces -s when 4 or more");
+    LOG("  --adaptive_threshold     <float>                Color difference in [0, 1] between neighbours that refines a pixel. Defaults to 0.1");
+    LOG("  -b,  --block_size        <int>                  Size in pixels of the MPI image task, and of the tiles of the threads");
+    LOG("  --threads                <int>                  Threads that render tiles. Defaults to 0, every hardware thread, shared among the MPI ranks of a node");
+    LOG("  --prefetch               <int>                  Task requests an MPI worker keeps in flight while rendering. Defaults to 1");
     LOG("  -z,  --zoom              <float>                Zoom level of camera");
     LOG("  -cx, --camera_x          <float>                Camera X position");
     LOG("  -cy, --camera_y          <float>                Camera Y position");
     LOG("  -i,  --iterations        <int>                  Max iterations for fractal");
     LOG("  -t,  --type              <int>                  Fractal type ID");
     LOG("  --color_mode             <int>                  Color mode type ID");
+    LOG("  --gradient               <file>                 Colors with the gradient of the file instead of the color mode");
     LOG("  --julia-cx               <float>                Real component of Julia set C constant");
     LOG("  --julia-cy               <float>                Imaginary component of Julia set C constant");
+    LOG("  --perturbation                                  Renders Mandelbrot with perturbation theory, for deep zooms");
+    LOG("  --auto_precision                                Renders each tile with the fastest precision that resolves its pixels");
+    LOG("  --no_interior_checks                            Iterates interior points up to the max iterations, without bulb and cycle checks");
+    LOG("  --subdivision                                   Fills rectangles with a uniform border without evaluating their pixels");
+    LOG("  --distance_fill                                 Fills the disks that distance estimates prove free of the boundary. Approximates exterior colors");
+    LOG("  --no_symmetry                                   Schedules every MPI block, instead of mirroring the symmetric ones");
+    LOG("  --no_master_render                              Keeps the MPI master from rendering tasks between answering the workers");
+    LOG("  --cost_order                                    Dispatches the MPI tasks from the slowest to the fastest, estimated by a low resolution pre-pass");
+    LOG("  --guided                                        Sends large runs of MPI tasks first and smaller ones as the image completes, by the throughput of each rank");
+    LOG("  --rma_counter                                   MPI ranks claim tasks from an atomic counter of the master, without requests");
     LOG("  --quiet                                         Disables all console messages");
     LOG("  --help                                          Show this help message");
 }
@@ -40,6 +57,47 @@ bool load_args(uint32_t argc, char** argv, Settings& settings)
             _s_logging_verbose = false;
             continue;
         }
+        if (!strcmp(parameter, "--perturbation")) {
+            settings.fractal.perturbation = true;
+            continue;
+        }
+        if (!strcmp(parameter, "--auto_precision")) {
+            settings.fractal.auto_precision = true;
+            continue;
+        }
+        if (!strcmp(parameter, "--no_interior_checks")) {
+            settings.fractal.interior_checks = false;
+            continue;
+        }
+        if (!strcmp(parameter, "--subdivision")) {
+            settings.fractal.subdivision = true;
+            continue;
+        }
+        if (!strcmp(parameter, "--distance_fill")) {
+            settings.fractal.distance_fill = true;
+            continue;
+        }
+        if (!strcmp(parameter, "--no_symmetry")) {
+            settings.fractal.symmetry = false;
+            continue;
+        }
+        if (!strcmp(parameter, "--no_master_render")) {
+            settings.master_renders = false;
+            continue;
+        }
+        if (!strcmp(parameter, "--cost_order")) {
+            settings.cost_order = true;
+            continue;
+        }
+        if (!strcmp(parameter, "--guided")) {
+            settings.guided = true;
+            continue;
+        }
+        if (!strcmp(parameter, "--rma_counter")) {
+            settings.rma_counter = true;
+            continue;
+        }
+
         // Arguments with multiple varying parameters -----------------------------------------
         if (!strcmp(parameter, "-od") || !strcmp(parameter, "--output_disk")) {
             settings.output_settings.mode = OutputSettingsMode::DISK;
@@ -73,6 +131,16 @@ bool load_args(uint32_t argc, char** argv, Settings& settings)
             continue;
         }
 
+        if (!strcmp(parameter, "-of") || !strcmp(parameter, "--output_field")) {
+            settings.output_settings.mode = OutputSettingsMode::FIELD;
+            std::strcpy(settings.output_settings.disk_data.output_path, "./output.field");
+
+            if (arg_index + 1 < argc && argv[arg_index + 1][0] != '-')
+                std::strcpy(settings.output_settings.disk_data.output_path, argv[++arg_index]);
+
+            continue;
+        }
+
         if (!strcmp(parameter, "--output_disabled")) {
             settings.output_settings.mode = OutputSettingsMode::DISABLED;
             continue;
@@ -100,8 +168,16 @@ bool load_args(uint32_t argc, char** argv, Settings& settings)
                 settings.image.multi_sample_anti_aliasing = 1;
             }
 
+        } else if (!strcmp(parameter, "-as") || !strcmp(parameter, "--adaptive_samples")) {
+            settings.image.adaptive_samples = std::atoi(value);
+        } else if (!strcmp(parameter, "--adaptive_threshold")) {
+            settings.image.adaptive_threshold = std::atof(value);
         } else if (!strcmp(parameter, "-b") || !strcmp(parameter, "--block_size")) {
             settings.block_size = std::atoi(value);
+        } else if (!strcmp(parameter, "--threads")) {
+            settings.threads = std::atoi(value);
+        } else if (!strcmp(parameter, "--prefetch")) {
+            settings.prefetch = std::atoi(value);
         } else if (!strcmp(parameter, "-z") || !strcmp(parameter, "--zoom")) {
             DESERIALIZE_NUM(settings.camera.zoom, value);
         } else if (!strcmp(parameter, "-cx") || !strcmp(parameter, "--camera_x")) {
@@ -124,6 +200,9 @@ bool load_args(uint32_t argc, char** argv, Settings& settings)
             } else {
                 settings.fractal.color_mode = static_cast<ColorMode>(color_mode);
             }
+        } else if (!strcmp(parameter, "--gradient")) {
+            if (!load_gradient(value, settings.fractal.gradient))
+                LOG_WARNING("Unable to load gradient \"" << value << "\". Using the color mode");
         } else if (!strcmp(parameter, "--julia-cx")) {
             settings.fractal.julia_settings.Cx = atof(value);
         } else if (!strcmp(parameter, "--julia-cy")) {
@@ -132,5 +211,10 @@ bool load_args(uint32_t argc, char** argv, Settings& settings)
             LOG_WARNING("Unrecognized parameter \"" << parameter << "\"");
         }
     }
+
+    if (settings.fractal.perturbation && settings.fractal.type != FractalType::MANDELBROT) {
+        LOG_WARNING("Perturbation is only implemented for Mandelbrot. Disabling it");
+        settings.fractal.perturbation = false;
+    }
     return true;
 }
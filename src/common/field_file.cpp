@@ -0,0 +1,152 @@
+#include "field_file.h"
+#include "common/logging.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+
+FieldFile::FieldFile()
+    : data(nullptr)
+    , size(0)
+    , header(nullptr)
+    , tile_values(0)
+{
+}
+
+FieldFile::~FieldFile()
+{
+    close();
+}
+
+void FieldFile::close()
+{
+    if (data)
+        munmap(data, size);
+
+    data = nullptr;
+    header = nullptr;
+    size = 0;
+}
+
+bool FieldFile::create(
+    const char* path,
+    uint32_t width,
+    uint32_t height,
+    uint32_t samples_per_pixel,
+    uint32_t tile_size,
+    uint32_t max_iterations)
+{
+    close();
+
+    FieldFileHeader new_header;
+    memset(&new_header, 0, sizeof(new_header));
+    strcpy(new_header.magic, FIELD_FILE_MAGIC);
+    new_header.version = FIELD_FILE_VERSION;
+    new_header.width = width;
+    new_header.height = height;
+    new_header.samples_per_pixel = samples_per_pixel;
+    new_header.tile_size = tile_size;
+    new_header.tiles_x = (width + tile_size - 1) / tile_size;
+    new_header.tiles_y = (height + tile_size - 1) / tile_size;
+    new_header.max_iterations = max_iterations;
+    new_header.data_offset = FIELD_FILE_ALIGNMENT;
+
+    tile_values = (uint64_t)tile_size * tile_size * samples_per_pixel;
+    size = new_header.data_offset + (uint64_t)new_header.tiles_x * new_header.tiles_y * tile_values * sizeof(float);
+
+    int file = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        LOG_ERROR("Unable to create field file \"" << path << "\"");
+        return false;
+    }
+
+    // The tiles are written through the mapping as blocks arrive
+    if (ftruncate(file, size) != 0) {
+        LOG_ERROR("Unable to resize field file \"" << path << "\" to " << size << " bytes");
+        ::close(file);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    ::close(file);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Unable to map field file \"" << path << "\"");
+        return false;
+    }
+
+    data = (uint8_t*)mapping;
+    memcpy(data, &new_header, sizeof(new_header));
+    header = (const FieldFileHeader*)data;
+    return true;
+}
+
+bool FieldFile::open(const char* path)
+{
+    close();
+
+    int file = ::open(path, O_RDONLY);
+    if (file < 0) {
+        LOG_ERROR("Unable to open field file \"" << path << "\"");
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(FieldFileHeader)) {
+        LOG_ERROR("Field file \"" << path << "\" is too small");
+        ::close(file);
+        return false;
+    }
+
+    size = file_stat.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Unable to map field file \"" << path << "\"");
+        size = 0;
+        return false;
+    }
+
+    data = (uint8_t*)mapping;
+    header = (const FieldFileHeader*)data;
+    tile_values = (uint64_t)header->tile_size * header->tile_size * header->samples_per_pixel;
+
+    uint64_t expected_size = header->data_offset + (uint64_t)header->tiles_x * header->tiles_y * tile_values * sizeof(float);
+    if (memcmp(header->magic, FIELD_FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != FIELD_FILE_VERSION || size < expected_size) {
+        LOG_ERROR("\"" << path << "\" isn't a version " << FIELD_FILE_VERSION << " field file");
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FieldFile::write_block(
+    const float* samples,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height)
+{
+    const uint32_t tile_size = header->tile_size;
+    const uint32_t samples_per_pixel = header->samples_per_pixel;
+    float* tiles = (float*)(data + header->data_offset);
+
+    // Each row of the block is copied as one segment per tile it crosses
+    for (uint32_t j = 0; j < height; ++j) {
+        uint32_t row = y + j;
+        const float* source = samples + (uint64_t)j * width * samples_per_pixel;
+
+        for (uint32_t column = x; column < x + width;) {
+            uint32_t tile_x = column / tile_size;
+            uint32_t segment = std::min(x + width, (tile_x + 1) * tile_size) - column;
+
+            float* tile = tiles + ((uint64_t)(row / tile_size) * header->tiles_x + tile_x) * tile_values;
+            float* destination = tile + ((uint64_t)(row % tile_size) * tile_size + column % tile_size) * samples_per_pixel;
+            memcpy(destination, source, (size_t)segment * samples_per_pixel * sizeof(float));
+
+            source += (uint64_t)segment * samples_per_pixel;
+            column += segment;
+        }
+    }
+}
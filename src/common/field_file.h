@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define FIELD_FILE_MAGIC "FRACFLD"
+#define FIELD_FILE_VERSION 1
+
+/// @brief Offset of the tiles from the start of the file, past the header. Tiles are packed
+/// one after another from there, so only the first one starts at a page
+#define FIELD_FILE_ALIGNMENT 4096
+
+/// @brief Header at the start of a field file, in the byte order of the machine that wrote
+/// it. The header is followed, from data_offset, by tiles_x * tiles_y tiles in row major
+/// order. Every tile holds tile_size * tile_size pixels in row major order, including the
+/// pixels past the image of the last tiles, and every pixel holds samples_per_pixel floats.
+/// The samples are ordered by sample x, then by sample y, and hold the smoothed iteration
+/// value in [0, 1] that colors them, where 1 is inside the set
+struct FieldFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width, height;
+    uint32_t samples_per_pixel;
+    uint32_t tile_size;
+    uint32_t tiles_x, tiles_y;
+    uint32_t max_iterations;
+    uint64_t data_offset;
+};
+
+/// @brief Smoothed iteration values of an image, mapped from a field file, so that the
+/// image can be colored again with any palette without rendering it
+class FieldFile {
+public:
+    FieldFile();
+    ~FieldFile();
+
+    /// @brief Creates the file with every tile, and maps it for writing
+    bool create(
+        const char* path,
+        uint32_t width,
+        uint32_t height,
+        uint32_t samples_per_pixel,
+        uint32_t tile_size,
+        uint32_t max_iterations);
+
+    /// @brief Maps an existing file for reading
+    bool open(const char* path);
+
+    const FieldFileHeader& get_header() const { return *header; }
+
+    /// @brief Samples of the pixels of a tile
+    const float* get_tile(uint32_t tile_x, uint32_t tile_y) const
+    {
+        return (const float*)(data + header->data_offset) + ((uint64_t)tile_y * header->tiles_x + tile_x) * tile_values;
+    }
+
+    /// @brief Samples of the pixel at (x, y)
+    float* get_pixel(uint32_t x, uint32_t y)
+    {
+        const float* tile = get_tile(x / header->tile_size, y / header->tile_size);
+        uint64_t offset = ((uint64_t)(y % header->tile_size) * header->tile_size + x % header->tile_size) * header->samples_per_pixel;
+        return (float*)tile + offset;
+    }
+
+    /// @brief Copies the samples of a block, stored as rows of width pixels, into the
+    /// tiles the block covers
+    void write_block(
+        const float* samples,
+        uint32_t x,
+        uint32_t y,
+        uint32_t width,
+        uint32_t height);
+
+private:
+    void close();
+
+    uint8_t* data;
+    size_t size;
+    const FieldFileHeader* header;
+    uint64_t tile_values;
+};
@@ -1,10 +1,32 @@
 #pragma once
 #include "settings/fractal_settings.h"
 #include "common.h"
+#include "precision_tier.h"
 
-typedef float(FractalSampler)(number wx, number wy, const FractalSettings& settings);
+float mandelbrot_sampler(const number&, const number&, const FractalSettings&);
+float julia_sampler(const number&, const number&, const FractalSettings&);
 
-float mandelbrot_sampler(number, number, const FractalSettings&);
-float julia_sampler(number, number, const FractalSettings&);
+/// @brief Samples count points at once, writing the normalized value of each one into t
+void mandelbrot_batch_sampler(const number*, const number*, float*, uint32_t, const FractalSettings&);
+void julia_batch_sampler(const number*, const number*, float*, uint32_t, const FractalSettings&);
 
-FractalSampler* get_fractal_sampler(FractalType);
\ No newline at end of file
+/// @brief Same as the batch samplers, also writing a lower bound of the distance in world
+/// units from each point to the boundary of the set, or 0 for points without an estimate
+void mandelbrot_distance_batch_sampler(const number*, const number*, float*, double*, uint32_t, const FractalSettings&);
+void julia_distance_batch_sampler(const number*, const number*, float*, double*, uint32_t, const FractalSettings&);
+
+// Batch samplers of the precision tiers below number, see precision_tier.h
+#ifdef PRECISION_TIER_FLOAT
+void mandelbrot_batch_sampler(const float*, const float*, float*, uint32_t, const FractalSettings&);
+void julia_batch_sampler(const float*, const float*, float*, uint32_t, const FractalSettings&);
+#endif
+
+#ifdef PRECISION_TIER_DOUBLE
+void mandelbrot_batch_sampler(const double*, const double*, float*, uint32_t, const FractalSettings&);
+void julia_batch_sampler(const double*, const double*, float*, uint32_t, const FractalSettings&);
+#endif
+
+#ifdef PRECISION_TIER_EXTENDED
+void mandelbrot_batch_sampler(const double_double*, const double_double*, float*, uint32_t, const FractalSettings&);
+void julia_batch_sampler(const double_double*, const double_double*, float*, uint32_t, const FractalSettings&);
+#endif
@@ -0,0 +1,109 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <complex>
+
+/// @brief Escaped orbits are continued up to this squared radius before estimating the
+/// distance, since the estimate only holds for large orbit points
+#define DISTANCE_ESCAPE_RADIUS_SQUARED 1e8
+
+/// @brief Squared distance under which an orbit is back at the point of its cycle it started from
+#define DISTANCE_CYCLE_TOLERANCE_SQUARED 1e-24
+
+/// @brief One iteration of the derivative of the orbit, dz = 2 * z * dz + offset. The offset is
+/// 1 for the derivative with respect to c of Mandelbrot, and 0 with respect to z0 of Julia.
+/// Only the magnitude of the derivative matters, so it's tracked in double
+static inline void distance_derivative_step(double zx, double zy, double& dzx, double& dzy, double offset)
+{
+    double x = 2.0 * (zx * dzx - zy * dzy) + offset;
+    dzy = 2.0 * (zx * dzy + zy * dzx);
+    dzx = x;
+}
+
+/// @brief Lower bound of the distance from an escaped point to the set, from its orbit point z
+/// and derivative dz after iter iterations, and the constant c added at each iteration. With the
+/// Green function G = log|z| / 2^n, the Koebe 1/4 theorem bounds the distance below by
+/// (1 - e^(-2G)) / (4 |G'|). Returns 0 when the derivative overflowed
+static inline double escaped_distance(
+    double zx,
+    double zy,
+    double dzx,
+    double dzy,
+    double cx,
+    double cy,
+    double offset,
+    uint32_t iter)
+{
+    // The orbit already escaped, so double is enough to continue it. The radius is
+    // reached within a few iterations, unless c is past the escape radius
+    for (int extra = 0; zx * zx + zy * zy < DISTANCE_ESCAPE_RADIUS_SQUARED; ++extra) {
+        if (extra == 64)
+            return 0.0;
+
+        distance_derivative_step(zx, zy, dzx, dzy, offset);
+        double x = zx * zx - zy * zy + cx;
+        zy = 2.0 * zx * zy + cy;
+        zx = x;
+        iter++;
+    }
+
+    double length = hypot(zx, zy);
+    double derivative = hypot(dzx, dzy);
+    if (!isfinite(length) || !isfinite(derivative) || !(derivative > 0.0))
+        return 0.0;
+
+    // Past a few dozen iterations G is tiny, and 1 - e^(-2G) is 2G
+    double log_length = log(length);
+    double distance = iter < 64
+        ? -expm1(-2.0 * ldexp(log_length, -(int)iter)) * ldexp(length / (4.0 * derivative), iter)
+        : length * log_length / (2.0 * derivative);
+
+    return isfinite(distance) ? distance : 0.0;
+}
+
+/// @brief Lower bound of the distance from a point c inside the Mandelbrot set to the boundary, from a
+/// point z0 of the attracting cycle its orbit reached. The period p is the first return of the orbit to
+/// z0, within max_period iterations. With the derivatives of the p-th iterate at z0, the distance is
+/// between b / 4 and b, where b = (1 - |dz|^2) / |dcdz + dzdz * dc / (1 - dz)|. Returns 0 when the
+/// orbit doesn't return, or when the cycle isn't attracting
+static inline double interior_distance(double zx, double zy, double cx, double cy, uint32_t max_period)
+{
+    const std::complex<double> c(cx, cy), z0(zx, zy);
+    std::complex<double> z = z0, dz = 1.0, dc = 0.0, dzdz = 0.0, dcdz = 0.0;
+
+    for (uint32_t period = 1; period <= max_period; ++period) {
+        // Each derivative is updated from the previous values of the others
+        dcdz = 2.0 * (dcdz * z + dz * dc);
+        dzdz = 2.0 * (dzdz * z + dz * dz);
+        dc = 2.0 * z * dc + 1.0;
+        dz = 2.0 * z * dz;
+        z = z * z + c;
+
+        if (std::norm(z - z0) >= DISTANCE_CYCLE_TOLERANCE_SQUARED)
+            continue;
+
+        double multiplier = std::norm(dz);
+        if (!(multiplier < 1.0))
+            return 0.0;
+
+        double distance = (1.0 - multiplier) / (4.0 * std::abs(dcdz + dzdz * dc / (1.0 - dz)));
+        return isfinite(distance) ? distance : 0.0;
+    }
+    return 0.0;
+}
+
+/// @brief interior_distance() of a point c of the main cardioid or of the period 2 bulb, which the
+/// interior checks find without iterating. Their cycles are known: the fixed point (1 - sqrt(1 - 4c)) / 2
+/// of the cardioid, and the points (-1 +- sqrt(-3 - 4c)) / 2 of the bulb
+static inline double main_bulbs_interior_distance(double cx, double cy)
+{
+    const std::complex<double> c(cx, cy);
+
+    std::complex<double> fixed_point = 0.5 * (1.0 - std::sqrt(1.0 - 4.0 * c));
+    double distance = interior_distance(fixed_point.real(), fixed_point.imag(), cx, cy, 1);
+    if (distance > 0.0)
+        return distance;
+
+    std::complex<double> cycle_point = 0.5 * (-1.0 + std::sqrt(-3.0 - 4.0 * c));
+    return interior_distance(cycle_point.real(), cycle_point.imag(), cx, cy, 2);
+}
@@ -1,77 +1,187 @@
 #include "../fractal.h"
 #include "../common.h"
+#include "../simd.h"
+#include "distance_estimate.h"
 #include <cstdint>
+#include <algorithm>
+#include <string.h>
+#include <type_traits>
+
+/// @brief Same smoothing as the other precisions. The orbit already escaped, so
+/// double holds everything that shows in the result
+static inline float julia_double_smooth_t(
+    double length_squared,
+    uint32_t iter,
+    const FractalSettings& settings)
+{
+    // Points that never escaped are inside, whatever their last orbit point
+    if (iter >= settings.max_iterations)
+        return 1.0f;
+
+    double smooth_t = (double)iter - log2(log(length_squared) / 1.38629436112);
+    return (float)(smooth_t / (double)settings.max_iterations);
+}
 
 #ifndef USE_MPFR
-const number two(2.0);
-const number four(4.0);
+#ifdef PRECISION_FIXED_POINT
+/// @brief Fixed point has no NaN for the logarithm of orbits that never escaped,
+/// so it's smoothed in double to match the other precisions
+static inline float julia_smooth_t(
+    const number& length_squared,
+    uint32_t iter,
+    const FractalSettings& settings)
+{
+    return julia_double_smooth_t((double)length_squared, iter, settings);
+}
+#else
 const number ln_four(1.38629436112);
 
-float julia_sampler(
-    number world_x,
-    number world_y,
+/// @brief Maps the escape iteration and the final squared length into normalized smooth t
+static inline float julia_smooth_t(
+    number length_squared,
+    uint32_t iter,
+    const FractalSettings& settings)
+{
+    if (iter >= settings.max_iterations)
+        return 1.0f;
+
+    // Computes smooth t in range [0.0, max_iterations]
+    number smooth_t = (number)iter - LOG2_NUM(LOG_NUM(length_squared) / ln_four);
+
+    // Normalizes
+    return (float)(smooth_t / (number)settings.max_iterations);
+}
+#endif
+#endif
+
+/// @brief Smoothing of the kernels iterated with T. Precision tiers below number
+/// are smoothed in double
+template <typename T>
+static inline float julia_kernel_smooth_t(
+    const T& length_squared,
+    uint32_t iter,
     const FractalSettings& settings)
 {
+    if constexpr (std::is_same<T, number>::value)
+        return julia_smooth_t(length_squared, iter, settings);
+    else
+        return julia_double_smooth_t((double)length_squared, iter, settings);
+}
+
+/// @brief Iterates a point with the arithmetic of T. With DISTANCE, the derivative of the
+/// orbit is tracked as well, and the distance estimate is written to distance, or 0 if
+/// the point didn't escape
+template <typename T, bool DISTANCE = false>
+static inline float julia_iterate(
+    const T& world_x,
+    const T& world_y,
+    const FractalSettings& settings,
+    double* distance = nullptr)
+{
+    if constexpr (DISTANCE)
+        *distance = 0.0;
 
     // Z(n+1) = Z(n)^2 + C
     // Constant C = Cx + Cyi
-    const number Cx = settings.julia_settings.Cx;
-    const number Cy = settings.julia_settings.Cy;
+    const T Cx = settings.julia_settings.Cx;
+    const T Cy = settings.julia_settings.Cy;
 
-    number zx = world_x, zy = world_y;
+    T zx = world_x, zy = world_y;
     uint32_t iter = 0;
 
-    number length_squared = zx * zx + zy * zy;
-    number xtemp;
+    // Brent's cycle detection. The orbit is saved at every power of two iteration,
+    // so a cycle of any period is eventually compared against a saved point
+    T saved_zx = zx, saved_zy = zy;
+    uint32_t checkpoint = 1;
+
+    // Derivative with respect to z0
+    double dzx = 1.0, dzy = 0.0;
+
+    T length_squared = zx * zx + zy * zy;
+    T xtemp;
     while (length_squared < 4.0 && iter < settings.max_iterations) {
+        if constexpr (DISTANCE)
+            distance_derivative_step((double)zx, (double)zy, dzx, dzy, 0.0);
+
         xtemp = zx * zx - zy * zy + Cx;
-        zy = two * zx * zy + Cy;
+        // 2 * zx * zy as a sum, like the vector kernels
+        T zxy = zx * zy;
+        zy = zxy + zxy + Cy;
         zx = xtemp;
         iter++;
         length_squared = zx * zx + zy * zy;
+
+        if (settings.interior_checks) {
+            // A repeated orbit point repeats forever, so the orbit never escapes
+            if (zx == saved_zx && zy == saved_zy)
+                return 1.0f;
+
+            if (iter == checkpoint) {
+                saved_zx = zx;
+                saved_zy = zy;
+                checkpoint <<= 1;
+            }
+        }
     }
 
-    // Computes smooth t in range [0.0, max_iterations]
-    number smooth_t = (number)iter - LOG2_NUM(LOG_NUM(length_squared) / ln_four);
+    if constexpr (DISTANCE) {
+        if (iter < settings.max_iterations)
+            *distance = escaped_distance((double)zx, (double)zy, dzx, dzy, (double)Cx, (double)Cy, 0.0, iter);
+    }
 
-    // Normalizes
-    return (float)(smooth_t / (number)settings.max_iterations);
+    return julia_kernel_smooth_t(length_squared, iter, settings);
 }
-#else
-#include <mpfr.h>
+
+#ifndef USE_MPFR
 float julia_sampler(
-    number world_x,
-    number world_y,
+    const number& world_x,
+    const number& world_y,
     const FractalSettings& settings)
 {
-    const number Cx = settings.julia_settings.Cx;
-    const number Cy = settings.julia_settings.Cy;
-
-    // Define MPFR variables
-    mpfr_t two, four;
-    mpfr_t zx, zy;
-    mpfr_t zx2, zy2;
-    mpfr_t xtemp;
-    mpfr_t length_squared;
-    mpfr_t log_ls, log_four, ratio, log2_ratio;
-    mpfr_t smooth_t, max_iterations_f, result;
-
-    // Init with default precision
-    mpfr_inits2(DEFAULT_PRECISION,
-        two, four, zx, zy, zx2, zy2, xtemp,
-        length_squared, log_ls, log_four, ratio, log2_ratio,
-        smooth_t, max_iterations_f, result, (mpfr_ptr)0);
-
-    // Constants
-    mpfr_set_si(two, 2, MPFR_RNDN);
-    mpfr_set_si(four, 4, MPFR_RNDN);
-    mpfr_log(log_four, four, MPFR_RNDN);
+    return julia_iterate(world_x, world_y, settings);
+}
+#else
+#include <mpfr.h>
+
+/// @brief Tracks the derivative of the orbit and writes the distance estimate when
+/// distance isn't null, see julia_iterate()
+static float julia_mpfr_iterate(
+    const number& world_x,
+    const number& world_y,
+    const FractalSettings& settings,
+    double* distance)
+{
+    if (distance)
+        *distance = 0.0;
+
+    const number& Cx = settings.julia_settings.Cx;
+    const number& Cy = settings.julia_settings.Cy;
+
+    // Variables are kept across samples, with the precision of the coordinates,
+    // which grows past the default for deep zooms
+    thread_local MpfrScratch<8> scratch;
+    scratch.set_precision(std::max(mpfr_get_prec(world_x.n_ptr), mpfr_get_prec(world_y.n_ptr)));
+
+    mpfr_ptr zx = scratch[0];
+    mpfr_ptr zy = scratch[1];
+    mpfr_ptr zx2 = scratch[2];
+    mpfr_ptr zy2 = scratch[3];
+    mpfr_ptr xtemp = scratch[4];
+    mpfr_ptr length_squared = scratch[5];
+    mpfr_ptr saved_zx = scratch[6];
+    mpfr_ptr saved_zy = scratch[7];
 
     // z = world_x + i*world_y
     mpfr_set(zx, world_x.n_ptr, MPFR_RNDN);
     mpfr_set(zy, world_y.n_ptr, MPFR_RNDN);
 
+    // Brent's cycle detection, see julia_iterate()
+    mpfr_set(saved_zx, zx, MPFR_RNDN);
+    mpfr_set(saved_zy, zy, MPFR_RNDN);
+    uint32_t checkpoint = 1;
+
     uint32_t iter = 0;
+    double dzx = 1.0, dzy = 0.0;
 
     while (true) {
         // zx2 = zx * zx
@@ -81,43 +191,362 @@ float julia_sampler(
         // length_squared = zx2 + zy2
         mpfr_add(length_squared, zx2, zy2, MPFR_RNDN);
 
-        if (mpfr_cmp(length_squared, four) >= 0 || iter >= settings.max_iterations)
+        if (mpfr_cmp_si(length_squared, 4) >= 0 || iter >= settings.max_iterations)
             break;
 
+        if (distance)
+            distance_derivative_step(mpfr_get_d(zx, MPFR_RNDN), mpfr_get_d(zy, MPFR_RNDN), dzx, dzy, 0.0);
+
         // xtemp = zx2 - zy2 + cx
         mpfr_sub(xtemp, zx2, zy2, MPFR_RNDN);
         mpfr_add(xtemp, xtemp, Cx.n_ptr, MPFR_RNDN);
 
-        // zy = 2 * zx * zy + cy
+        // zy = 2 * zx * zy + cy, where doubling is an exponent increment
         mpfr_mul(zy, zx, zy, MPFR_RNDN);
-        mpfr_mul(zy, zy, two, MPFR_RNDN);
+        mpfr_mul_2ui(zy, zy, 1, MPFR_RNDN);
         mpfr_add(zy, zy, Cy.n_ptr, MPFR_RNDN);
 
-        // zx = xtemp
-        mpfr_set(zx, xtemp, MPFR_RNDN);
+        // zx = xtemp, swapping the limbs instead of copying them
+        mpfr_swap(zx, xtemp);
 
         iter++;
+
+        if (settings.interior_checks) {
+            if (mpfr_cmp(zx, saved_zx) == 0 && mpfr_cmp(zy, saved_zy) == 0)
+                return 1.0f;
+
+            if (iter == checkpoint) {
+                mpfr_set(saved_zx, zx, MPFR_RNDN);
+                mpfr_set(saved_zy, zy, MPFR_RNDN);
+                checkpoint <<= 1;
+            }
+        }
+    }
+
+    if (distance && iter < settings.max_iterations) {
+        *distance = escaped_distance(
+            mpfr_get_d(zx, MPFR_RNDN),
+            mpfr_get_d(zy, MPFR_RNDN),
+            dzx,
+            dzy,
+            mpfr_get_d(Cx.n_ptr, MPFR_RNDN),
+            mpfr_get_d(Cy.n_ptr, MPFR_RNDN),
+            0.0,
+            iter);
     }
 
-    // Smooth iteration count
-    mpfr_log(log_ls, length_squared, MPFR_RNDN);
-    mpfr_div(ratio, log_ls, log_four, MPFR_RNDN);
-    mpfr_log2(log2_ratio, ratio, MPFR_RNDN);
-    mpfr_set_si(smooth_t, iter, MPFR_RNDN);
-    mpfr_sub(smooth_t, smooth_t, log2_ratio, MPFR_RNDN);
+    return julia_double_smooth_t(mpfr_get_d(length_squared, MPFR_RNDN), iter, settings);
+}
+
+float julia_sampler(
+    const number& world_x,
+    const number& world_y,
+    const FractalSettings& settings)
+{
+    return julia_mpfr_iterate(world_x, world_y, settings, nullptr);
+}
+
+void julia_distance_batch_sampler(
+    const number* world_x,
+    const number* world_y,
+    float* t,
+    double* distance,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        t[i] = julia_mpfr_iterate(world_x[i], world_y[i], settings, distance + i);
+}
+
+#endif
 
-    // Normalize to [0,1]
-    mpfr_set_si(max_iterations_f, settings.max_iterations, MPFR_RNDN);
-    mpfr_div(result, smooth_t, max_iterations_f, MPFR_RNDN);
+#ifdef SIMD_X86
+/// @brief Iterates lanes::unroll registers of N points in lockstep. Lanes that escaped
+/// keep their last value, so the smoothing step sees the same orbit point as the
+/// scalar sampler. With DISTANCE, the derivative is iterated in double along the orbit,
+/// and the estimates of julia_iterate() are written to distance
+template <typename T, int N, bool DISTANCE>
+static SIMD_INLINE void julia_lanes(
+    const T* world_x,
+    const T* world_y,
+    float* t,
+    double* distance,
+    const FractalSettings& settings)
+{
+    typedef SimdLanes<T, N> lanes;
+    typedef typename lanes::vec vec;
+    typedef typename lanes::mask mask;
+    typedef typename lanes::wide wide;
+    constexpr int U = lanes::unroll;
 
-    float output = mpfr_get_flt(result, MPFR_RNDN);
+    vec Cx, Cy;
+    lanes::broadcast(Cx, settings.julia_settings.Cx);
+    lanes::broadcast(Cy, settings.julia_settings.Cy);
 
-    mpfr_clears(two, four, zx, zy, zx2, zy2, xtemp,
-        length_squared, log_ls, log_four,
-        ratio, log2_ratio, smooth_t,
-        max_iterations_f, result, (mpfr_ptr)0);
+    vec zx[U], zy[U];
+    vec length_squared[U];
+    mask iter[U];
 
-    return output;
+    // Lanes in a cycle, which stop iterating
+    mask inside[U];
+
+    // Derivative of the orbit with respect to z0
+    wide dzx[U], dzy[U];
+
+    // Brent's cycle detection, see julia_iterate(). All lanes share the
+    // iteration count, so they are saved together
+    vec saved_zx[U], saved_zy[U];
+    int32_t checkpoint = 1;
+
+    for (int u = 0; u < U; ++u) {
+        lanes::load(zx[u], world_x + u * N);
+        lanes::load(zy[u], world_y + u * N);
+        length_squared[u] = zx[u] * zx[u] + zy[u] * zy[u];
+        saved_zx[u] = zx[u];
+        saved_zy[u] = zy[u];
+        dzx[u] = wide {} + 1.0;
+        dzy[u] = wide {};
+        iter[u] = inside[u] = mask {};
+    }
+
+    vec escape_radius_squared;
+    lanes::broadcast(escape_radius_squared, T(4.0));
+
+    for (int32_t i = 0; i < settings.max_iterations; ++i) {
+        mask active[U];
+#pragma GCC unroll 4
+        for (int u = 0; u < U; ++u) {
+            lanes::less(active[u], length_squared[u], escape_radius_squared);
+            active[u] &= ~inside[u];
+        }
+
+        // Escaped lanes are frozen, so the early exit check doesn't need to run
+        // every iteration
+        if ((i & (SIMD_EXIT_CHECK_INTERVAL - 1)) == 0) {
+            if (!simd_any<N, U>(active))
+                break;
+
+            // Comparing on the same interval still finds every cycle, once the
+            // saved point is SIMD_EXIT_CHECK_INTERVAL periods behind
+            if (settings.interior_checks && i > 0) {
+                for (int u = 0; u < U; ++u) {
+                    mask x_less, x_greater, y_less, y_greater;
+                    lanes::less(x_less, zx[u], saved_zx[u]);
+                    lanes::less(x_greater, saved_zx[u], zx[u]);
+                    lanes::less(y_less, zy[u], saved_zy[u]);
+                    lanes::less(y_greater, saved_zy[u], zy[u]);
+                    inside[u] |= active[u] & ~(x_less | x_greater | y_less | y_greater);
+                    active[u] &= ~inside[u];
+                }
+            }
+        }
+
+        if (settings.interior_checks && i == checkpoint) {
+            for (int u = 0; u < U; ++u) {
+                saved_zx[u] = zx[u];
+                saved_zy[u] = zy[u];
+            }
+            checkpoint <<= 1;
+        }
+
+#pragma GCC unroll 4
+        for (int u = 0; u < U; ++u) {
+            // dz = 2 * z * dz from the orbit point before the step, as in
+            // distance_derivative_step()
+            if constexpr (DISTANCE) {
+                wide wide_zx, wide_zy;
+                lanes::to_wide(wide_zx, zx[u]);
+                lanes::to_wide(wide_zy, zy[u]);
+                wide dx = wide_zx * dzx[u] - wide_zy * dzy[u];
+                wide dy = wide_zx * dzy[u] + wide_zy * dzx[u];
+                lanes::blend_wide(dzx[u], active[u], dx + dx);
+                lanes::blend_wide(dzy[u], active[u], dy + dy);
+            }
+
+            vec next_zx = zx[u] * zx[u] - zy[u] * zy[u] + Cx;
+            // 2 * zx * zy as a sum, which is exact and cheaper than a product
+            // for number types made of several doubles
+            vec zxy = zx[u] * zy[u];
+            vec next_zy = zxy + zxy + Cy;
+            lanes::blend(zx[u], active[u], next_zx);
+            lanes::blend(zy[u], active[u], next_zy);
+
+            length_squared[u] = zx[u] * zx[u] + zy[u] * zy[u];
+
+            // Active lanes are -1
+            iter[u] -= active[u];
+        }
+    }
+
+    for (int u = 0; u < U; ++u) {
+        for (int k = 0; k < N; ++k) {
+            uint32_t lane_iter = inside[u][k] ? settings.max_iterations : (uint32_t)iter[u][k];
+            t[u * N + k] = julia_kernel_smooth_t<T>(lanes::lane(length_squared[u], k), lane_iter, settings);
+
+            if constexpr (DISTANCE) {
+                distance[u * N + k] = lane_iter < settings.max_iterations
+                    ? escaped_distance(
+                          (double)lanes::lane(zx[u], k),
+                          (double)lanes::lane(zy[u], k),
+                          dzx[u][k],
+                          dzy[u][k],
+                          settings.julia_settings.Cx,
+                          settings.julia_settings.Cy,
+                          0.0,
+                          lane_iter)
+                    : 0.0;
+            }
+        }
+    }
+}
+
+/// @brief Samples the span by lane groups. The distance estimates are written to
+/// distance unless it's null
+template <typename T, int N, bool DISTANCE>
+static SIMD_INLINE void julia_batch(
+    const T* world_x,
+    const T* world_y,
+    float* t,
+    double* distance,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+    constexpr uint32_t GROUP = N * SimdLanes<T, N>::unroll;
+
+    uint32_t i = 0;
+    for (; i + GROUP <= count; i += GROUP)
+        julia_lanes<T, N, DISTANCE>(world_x + i, world_y + i, t + i, DISTANCE ? distance + i : nullptr, settings);
+
+    if (i == count)
+        return;
+
+    // Pads the last lane group by repeating the final point
+    T tail_x[GROUP], tail_y[GROUP];
+    float tail_t[GROUP];
+    double tail_distance[GROUP];
+    for (uint32_t k = 0; k < GROUP; ++k) {
+        uint32_t src = std::min(i + k, count - 1);
+        tail_x[k] = world_x[src];
+        tail_y[k] = world_y[src];
+    }
+    julia_lanes<T, N, DISTANCE>(tail_x, tail_y, tail_t, tail_distance, settings);
+    memcpy(t + i, tail_t, (count - i) * sizeof(float));
+    if constexpr (DISTANCE)
+        memcpy(distance + i, tail_distance, (count - i) * sizeof(double));
+}
+
+template <typename T, int N>
+static SIMD_INLINE void julia_batch(const T* wx, const T* wy, float* t, double* distance, uint32_t count, const FractalSettings& settings)
+{
+    if (distance)
+        julia_batch<T, N, true>(wx, wy, t, distance, count, settings);
+    else
+        julia_batch<T, N, false>(wx, wy, t, nullptr, count, settings);
 }
 
-#endif
\ No newline at end of file
+template <typename T>
+SIMD_TARGET_SSE2 static void julia_batch_sse2(const T* wx, const T* wy, float* t, double* distance, uint32_t count, const FractalSettings& settings)
+{
+    julia_batch<T, simd_lanes<T>(SimdLevel::SSE2)>(wx, wy, t, distance, count, settings);
+}
+
+template <typename T>
+SIMD_TARGET_AVX2 static void julia_batch_avx2(const T* wx, const T* wy, float* t, double* distance, uint32_t count, const FractalSettings& settings)
+{
+    julia_batch<T, simd_lanes<T>(SimdLevel::AVX2)>(wx, wy, t, distance, count, settings);
+}
+
+template <typename T>
+SIMD_TARGET_AVX512 static void julia_batch_avx512(const T* wx, const T* wy, float* t, double* distance, uint32_t count, const FractalSettings& settings)
+{
+    julia_batch<T, simd_lanes<T>(SimdLevel::AVX512)>(wx, wy, t, distance, count, settings);
+}
+#endif
+
+/// @brief Samples the span with the widest vector kernels of the CPU, for types made of
+/// floats or doubles. Other types, or other architectures, are iterated one point at a time.
+/// The distance estimates are written to distance unless it's null
+template <typename T>
+static void julia_span(
+    const T* world_x,
+    const T* world_y,
+    float* t,
+    double* distance,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+#ifdef SIMD_X86
+    switch (get_simd_level()) {
+    case SimdLevel::AVX512:
+        julia_batch_avx512(world_x, world_y, t, distance, count, settings);
+        break;
+    case SimdLevel::AVX2:
+        julia_batch_avx2(world_x, world_y, t, distance, count, settings);
+        break;
+    default:
+        julia_batch_sse2(world_x, world_y, t, distance, count, settings);
+        break;
+    }
+#else
+    for (uint32_t i = 0; i < count; ++i) {
+        if (distance)
+            t[i] = julia_iterate<T, true>(world_x[i], world_y[i], settings, distance + i);
+        else
+            t[i] = julia_iterate(world_x[i], world_y[i], settings);
+    }
+#endif
+}
+
+void julia_batch_sampler(
+    const number* world_x,
+    const number* world_y,
+    float* t,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+#ifdef NUMBER_SIMD
+    julia_span(world_x, world_y, t, nullptr, count, settings);
+#else
+    for (uint32_t i = 0; i < count; ++i)
+        t[i] = julia_sampler(world_x[i], world_y[i], settings);
+#endif
+}
+
+#ifndef USE_MPFR
+void julia_distance_batch_sampler(
+    const number* world_x,
+    const number* world_y,
+    float* t,
+    double* distance,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+#ifdef NUMBER_SIMD
+    julia_span(world_x, world_y, t, distance, count, settings);
+#else
+    for (uint32_t i = 0; i < count; ++i)
+        t[i] = julia_iterate<number, true>(world_x[i], world_y[i], settings, distance + i);
+#endif
+}
+#endif
+
+#ifdef PRECISION_TIER_FLOAT
+void julia_batch_sampler(const float* world_x, const float* world_y, float* t, uint32_t count, const FractalSettings& settings)
+{
+    julia_span(world_x, world_y, t, nullptr, count, settings);
+}
+#endif
+
+#ifdef PRECISION_TIER_DOUBLE
+void julia_batch_sampler(const double* world_x, const double* world_y, float* t, uint32_t count, const FractalSettings& settings)
+{
+    julia_span(world_x, world_y, t, nullptr, count, settings);
+}
+#endif
+
+#ifdef PRECISION_TIER_EXTENDED
+void julia_batch_sampler(const double_double* world_x, const double_double* world_y, float* t, uint32_t count, const FractalSettings& settings)
+{
+    julia_span(world_x, world_y, t, nullptr, count, settings);
+}
+#endif
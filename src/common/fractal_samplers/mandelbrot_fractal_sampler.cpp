@@ -1,86 +1,243 @@
-
 #include "../fractal.h"
 #include "../common.h"
+#include "../simd.h"
+#include "distance_estimate.h"
 #include <cstdint>
+#include <algorithm>
+#include <string.h>
+#include <type_traits>
+
+/// @brief Same smoothing as the other precisions. The orbit already escaped, so
+/// double holds everything that shows in the result
+static inline float mandelbrot_double_smooth_t(
+    double length_squared,
+    uint32_t iter,
+    const FractalSettings& settings)
+{
+    // Points that never escaped are inside, whatever their last orbit point
+    if (iter >= settings.max_iterations)
+        return 1.0f;
+
+    double smooth_t = (double)iter;
+    if (length_squared > 0.0) {
+        double log_zn = log(length_squared) / 2.0;
+        double nu = log2(log_zn / 0.69314718056);
+        smooth_t = (double)iter - nu;
+    }
+
+    return (float)(smooth_t / (double)settings.max_iterations);
+}
 
 #ifndef USE_MPFR
-const number two(2.0);
-const number four(4.0);
+#ifdef PRECISION_FIXED_POINT
+/// @brief Fixed point has no NaN for the logarithm of orbits that never escaped,
+/// so it's smoothed in double to match the other precisions
+static inline float mandelbrot_smooth_t(
+    const number& length_squared,
+    uint32_t iter,
+    const FractalSettings& settings)
+{
+    return mandelbrot_double_smooth_t((double)length_squared, iter, settings);
+}
+#else
 const number ln_two(0.69314718056);
 
-float mandelbrot_sampler(
-    number world_x,
-    number world_y,
+/// @brief Maps the escape iteration and the final squared length into normalized smooth t
+static inline float mandelbrot_smooth_t(
+    number length_squared,
+    uint32_t iter,
+    const FractalSettings& settings)
+{
+    if (iter >= settings.max_iterations)
+        return 1.0f;
+
+    // Avoid log() of zero or negative
+    number smooth_t = (number)iter;
+    if (length_squared > 0.0) {
+        number log_zn = LOG_NUM(length_squared) / 2.0;
+        number nu = LOG2_NUM(log_zn / ln_two);
+        smooth_t = (number)iter - nu;
+    }
+
+    return (float)(smooth_t / (number)settings.max_iterations);
+}
+#endif
+#endif
+
+/// @brief Smoothing of the kernels iterated with T. Precision tiers below number
+/// are smoothed in double
+template <typename T>
+static inline float mandelbrot_kernel_smooth_t(
+    const T& length_squared,
+    uint32_t iter,
     const FractalSettings& settings)
 {
-    number zx = 0.0;
-    number zy = 0.0;
-    number zx2 = 0.0;
-    number zy2 = 0.0;
+    if constexpr (std::is_same<T, number>::value)
+        return mandelbrot_smooth_t(length_squared, iter, settings);
+    else
+        return mandelbrot_double_smooth_t((double)length_squared, iter, settings);
+}
+
+/// @brief True for points of the main cardioid and of the period 2 bulb, which
+/// hold most of the interior of a zoomed out view
+template <typename T>
+static inline bool mandelbrot_in_main_bulbs(const T& world_x, const T& world_y)
+{
+    T xq = world_x - T(0.25);
+    T y2 = world_y * world_y;
+    T q = xq * xq + y2;
+    if (q * (q + xq) < T(0.25) * y2)
+        return true;
+
+    T xb = world_x + T(1.0);
+    return xb * xb + y2 < T(0.0625);
+}
+
+/// @brief Iterates a point with the arithmetic of T. With DISTANCE, the derivative of the
+/// orbit is tracked as well, and the distance estimate is written to distance. Points whose
+/// orbit ends in a cycle get the interior estimate, and the other points inside get 0
+template <typename T, bool DISTANCE = false>
+static inline float mandelbrot_iterate(
+    const T& world_x,
+    const T& world_y,
+    const FractalSettings& settings,
+    double* distance = nullptr)
+{
+    if constexpr (DISTANCE)
+        *distance = 0.0;
+
+    if (settings.interior_checks && mandelbrot_in_main_bulbs(world_x, world_y)) {
+        if constexpr (DISTANCE)
+            *distance = main_bulbs_interior_distance((double)world_x, (double)world_y);
+        return 1.0f;
+    }
+
+    T zx = 0.0;
+    T zy = 0.0;
+    T zx2 = 0.0;
+    T zy2 = 0.0;
     uint32_t iter = 0;
 
-    const number escape_radius_squared = 4.0;
+    // Brent's cycle detection. The orbit is saved at every power of two iteration,
+    // so a cycle of any period is eventually compared against a saved point
+    T saved_zx = zx, saved_zy = zy;
+    uint32_t checkpoint = 1;
+
+    const T escape_radius_squared = 4.0;
+    double dzx = 0.0, dzy = 0.0;
 
     while (zx2 + zy2 < escape_radius_squared && iter < settings.max_iterations) {
-        zy = two * zx * zy + world_y;
+        if constexpr (DISTANCE)
+            distance_derivative_step((double)zx, (double)zy, dzx, dzy, 1.0);
+
+        // 2 * zx * zy as a sum, like the vector kernels
+        T zxy = zx * zy;
+        zy = zxy + zxy + world_y;
         zx = zx2 - zy2 + world_x;
 
         zx2 = zx * zx;
         zy2 = zy * zy;
 
         ++iter;
+
+        if (settings.interior_checks) {
+            // A repeated orbit point repeats forever, so the orbit never escapes
+            if (zx == saved_zx && zy == saved_zy) {
+                if constexpr (DISTANCE)
+                    *distance = interior_distance((double)zx, (double)zy, (double)world_x, (double)world_y, iter);
+                return 1.0f;
+            }
+
+            if (iter == checkpoint) {
+                saved_zx = zx;
+                saved_zy = zy;
+                checkpoint <<= 1;
+            }
+        }
     }
 
-    // Avoid log() of zero or negative
-    number smooth_t = (number)iter;
-    if (zx2 + zy2 > 0.0) {
-        number log_zn = LOG_NUM(zx2 + zy2) / 2.0;
-        number nu = LOG2_NUM(log_zn / ln_two);
-        smooth_t = (number)iter - nu;
+    if constexpr (DISTANCE) {
+        if (iter < settings.max_iterations)
+            *distance = escaped_distance((double)zx, (double)zy, dzx, dzy, (double)world_x, (double)world_y, 1.0, iter);
     }
 
-    return (float)(smooth_t / (number)settings.max_iterations);
+    return mandelbrot_kernel_smooth_t(zx2 + zy2, iter, settings);
 }
 
-#else
-#include <mpfr.h>
+#ifndef USE_MPFR
 float mandelbrot_sampler(
-    number world_x,
-    number world_y,
+    const number& world_x,
+    const number& world_y,
     const FractalSettings& settings)
 {
-    // Define MPFR variables
-    mpfr_t two, four;
-    mpfr_t zx, zy;
-    mpfr_t zx2, zy2; // zx^2 and zy^2
-    mpfr_t xtemp;
-    mpfr_t length_squared;
-    mpfr_t log_ls; // log(length_squared)
-    mpfr_t log_four; // log(4)
-    mpfr_t ratio; // log_ls / log_four
-    mpfr_t log2_ratio; // log2(ratio)
-    mpfr_t smooth_t;
-    mpfr_t max_iterations_f;
-    mpfr_t result;
-
-    // Init with default precision
-    mpfr_inits2(DEFAULT_PRECISION, two, four, zx, zy, zx2, zy2, xtemp,
-        length_squared, log_ls, log_four, ratio, log2_ratio,
-        smooth_t, max_iterations_f, result, (mpfr_ptr)0);
-
-    // Constants
-    mpfr_set_si(two, 2, MPFR_RNDN);
-    mpfr_set_si(four, 4, MPFR_RNDN);
-    mpfr_log(log_four, four, MPFR_RNDN); // log(4)
+    return mandelbrot_iterate(world_x, world_y, settings);
+}
+
+#else
+#include <mpfr.h>
+
+/// @brief Tracks the derivative of the orbit and writes the distance estimate when
+/// distance isn't null, see mandelbrot_iterate()
+static float mandelbrot_mpfr_iterate(
+    const number& world_x,
+    const number& world_y,
+    const FractalSettings& settings,
+    double* distance)
+{
+    if (distance)
+        *distance = 0.0;
+
+    // Variables are kept across samples, with the precision of the coordinates,
+    // which grows past the default for deep zooms
+    thread_local MpfrScratch<8> scratch;
+    scratch.set_precision(std::max(mpfr_get_prec(world_x.n_ptr), mpfr_get_prec(world_y.n_ptr)));
+
+    mpfr_ptr zx = scratch[0];
+    mpfr_ptr zy = scratch[1];
+    mpfr_ptr zx2 = scratch[2]; // zx^2
+    mpfr_ptr zy2 = scratch[3]; // zy^2
+    mpfr_ptr xtemp = scratch[4];
+    mpfr_ptr length_squared = scratch[5];
+    mpfr_ptr saved_zx = scratch[6];
+    mpfr_ptr saved_zy = scratch[7];
+
+    if (settings.interior_checks) {
+        // Main cardioid, q * (q + x - 1/4) < y^2 / 4 with q = (x - 1/4)^2 + y^2
+        mpfr_sub_d(xtemp, world_x.n_ptr, 0.25, MPFR_RNDN);
+        mpfr_mul(zy2, world_y.n_ptr, world_y.n_ptr, MPFR_RNDN);
+        mpfr_mul(zx2, xtemp, xtemp, MPFR_RNDN);
+        mpfr_add(zx2, zx2, zy2, MPFR_RNDN);
+        mpfr_add(length_squared, zx2, xtemp, MPFR_RNDN);
+        mpfr_mul(length_squared, length_squared, zx2, MPFR_RNDN);
+        mpfr_mul_d(zx, zy2, 0.25, MPFR_RNDN);
+        if (mpfr_cmp(length_squared, zx) < 0) {
+            if (distance)
+                *distance = main_bulbs_interior_distance(mpfr_get_d(world_x.n_ptr, MPFR_RNDN), mpfr_get_d(world_y.n_ptr, MPFR_RNDN));
+            return 1.0f;
+        }
+
+        // Period 2 bulb, (x + 1)^2 + y^2 < 1/16
+        mpfr_add_d(xtemp, world_x.n_ptr, 1.0, MPFR_RNDN);
+        mpfr_mul(zx2, xtemp, xtemp, MPFR_RNDN);
+        mpfr_add(zx2, zx2, zy2, MPFR_RNDN);
+        if (mpfr_cmp_d(zx2, 0.0625) < 0) {
+            if (distance)
+                *distance = main_bulbs_interior_distance(mpfr_get_d(world_x.n_ptr, MPFR_RNDN), mpfr_get_d(world_y.n_ptr, MPFR_RNDN));
+            return 1.0f;
+        }
+    }
 
     // zx = zy = 0.0
-    mpfr_set_d(zx, 0.0, MPFR_RNDN);
-    mpfr_set_d(zy, 0.0, MPFR_RNDN);
+    mpfr_set_zero(zx, 1);
+    mpfr_set_zero(zy, 1);
 
-    // Start with 0 length
-    mpfr_set_d(length_squared, 0.0, MPFR_RNDN);
+    // Brent's cycle detection, see mandelbrot_iterate()
+    mpfr_set_zero(saved_zx, 1);
+    mpfr_set_zero(saved_zy, 1);
+    uint32_t checkpoint = 1;
 
     uint32_t iter = 0;
+    double dzx = 0.0, dzy = 0.0;
 
     // Loop
     while (true) {
@@ -88,44 +245,393 @@ float mandelbrot_sampler(
         mpfr_mul(zy2, zy, zy, MPFR_RNDN); // zy^2
         mpfr_add(length_squared, zx2, zy2, MPFR_RNDN); // zx^2 + zy^2
 
-        if (mpfr_cmp(length_squared, four) >= 0 || iter >= settings.max_iterations)
+        if (mpfr_cmp_si(length_squared, 4) >= 0 || iter >= settings.max_iterations)
             break;
 
+        if (distance)
+            distance_derivative_step(mpfr_get_d(zx, MPFR_RNDN), mpfr_get_d(zy, MPFR_RNDN), dzx, dzy, 1.0);
+
         // xtemp = zx^2 - zy^2 + world_x
         mpfr_sub(xtemp, zx2, zy2, MPFR_RNDN);
         mpfr_add(xtemp, xtemp, world_x.n_ptr, MPFR_RNDN);
 
-        // zy = 2 * zx * zy + world_y
+        // zy = 2 * zx * zy + world_y, where doubling is an exponent increment
         mpfr_mul(zy, zx, zy, MPFR_RNDN);
-        mpfr_mul(zy, zy, two, MPFR_RNDN);
+        mpfr_mul_2ui(zy, zy, 1, MPFR_RNDN);
         mpfr_add(zy, zy, world_y.n_ptr, MPFR_RNDN);
 
-        // zx = xtemp
-        mpfr_set(zx, xtemp, MPFR_RNDN);
+        // zx = xtemp, swapping the limbs instead of copying them
+        mpfr_swap(zx, xtemp);
 
         iter++;
+
+        if (settings.interior_checks) {
+            if (mpfr_cmp(zx, saved_zx) == 0 && mpfr_cmp(zy, saved_zy) == 0) {
+                if (distance) {
+                    *distance = interior_distance(
+                        mpfr_get_d(zx, MPFR_RNDN),
+                        mpfr_get_d(zy, MPFR_RNDN),
+                        mpfr_get_d(world_x.n_ptr, MPFR_RNDN),
+                        mpfr_get_d(world_y.n_ptr, MPFR_RNDN),
+                        iter);
+                }
+                return 1.0f;
+            }
+
+            if (iter == checkpoint) {
+                mpfr_set(saved_zx, zx, MPFR_RNDN);
+                mpfr_set(saved_zy, zy, MPFR_RNDN);
+                checkpoint <<= 1;
+            }
+        }
+    }
+
+    if (distance && iter < settings.max_iterations) {
+        *distance = escaped_distance(
+            mpfr_get_d(zx, MPFR_RNDN),
+            mpfr_get_d(zy, MPFR_RNDN),
+            dzx,
+            dzy,
+            mpfr_get_d(world_x.n_ptr, MPFR_RNDN),
+            mpfr_get_d(world_y.n_ptr, MPFR_RNDN),
+            1.0,
+            iter);
+    }
+
+    return mandelbrot_double_smooth_t(mpfr_get_d(length_squared, MPFR_RNDN), iter, settings);
+}
+
+float mandelbrot_sampler(
+    const number& world_x,
+    const number& world_y,
+    const FractalSettings& settings)
+{
+    return mandelbrot_mpfr_iterate(world_x, world_y, settings, nullptr);
+}
+
+void mandelbrot_distance_batch_sampler(
+    const number* world_x,
+    const number* world_y,
+    float* t,
+    double* distance,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        t[i] = mandelbrot_mpfr_iterate(world_x[i], world_y[i], settings, distance + i);
+}
+
+#endif
+
+#ifdef SIMD_X86
+/// @brief Iterates lanes::unroll registers of N points in lockstep. Lanes that escaped
+/// keep their last value, so the smoothing step sees the same orbit point as the
+/// scalar sampler. With DISTANCE, the derivative is iterated in double along the orbit,
+/// and the estimates of mandelbrot_iterate() are written to distance
+template <typename T, int N, bool DISTANCE>
+static SIMD_INLINE void mandelbrot_lanes(
+    const T* world_x,
+    const T* world_y,
+    float* t,
+    double* distance,
+    const FractalSettings& settings)
+{
+    typedef SimdLanes<T, N> lanes;
+    typedef typename lanes::vec vec;
+    typedef typename lanes::mask mask;
+    typedef typename lanes::wide wide;
+    constexpr int U = lanes::unroll;
+
+    vec cx[U], cy[U];
+    vec zx[U], zy[U];
+    vec zx2[U], zy2[U];
+    mask iter[U];
+
+    // Lanes known to be inside, which stop iterating
+    mask inside[U];
+
+    // Derivative of the orbit with respect to c, and the lanes inside the main bulbs,
+    // whose cycles are known without an orbit
+    wide dzx[U], dzy[U];
+    mask in_bulbs[U];
+
+    // Brent's cycle detection, see mandelbrot_iterate(). All lanes share the
+    // iteration count, so they are saved together
+    vec saved_zx[U], saved_zy[U];
+    int32_t checkpoint = 1;
+
+    for (int u = 0; u < U; ++u) {
+        lanes::load(cx[u], world_x + u * N);
+        lanes::load(cy[u], world_y + u * N);
+        zx[u] = zy[u] = zx2[u] = zy2[u] = vec {};
+        saved_zx[u] = saved_zy[u] = vec {};
+        dzx[u] = dzy[u] = wide {};
+        iter[u] = inside[u] = mask {};
+    }
+
+    if (settings.interior_checks) {
+        vec quarter, one, sixteenth;
+        lanes::broadcast(quarter, T(0.25));
+        lanes::broadcast(one, T(1.0));
+        lanes::broadcast(sixteenth, T(0.0625));
+
+        for (int u = 0; u < U; ++u) {
+            mask in_cardioid, in_bulb;
+            vec xq = cx[u] - quarter;
+            vec y2 = cy[u] * cy[u];
+            vec q = xq * xq + y2;
+            lanes::less(in_cardioid, q * (q + xq), quarter * y2);
+
+            vec xb = cx[u] + one;
+            lanes::less(in_bulb, xb * xb + y2, sixteenth);
+            inside[u] = in_cardioid | in_bulb;
+        }
+    }
+
+    for (int u = 0; u < U; ++u)
+        in_bulbs[u] = inside[u];
+
+    vec escape_radius_squared;
+    lanes::broadcast(escape_radius_squared, T(4.0));
+
+    for (int32_t i = 0; i < settings.max_iterations; ++i) {
+        mask active[U];
+#pragma GCC unroll 4
+        for (int u = 0; u < U; ++u) {
+            lanes::less(active[u], zx2[u] + zy2[u], escape_radius_squared);
+            active[u] &= ~inside[u];
+        }
+
+        // Escaped lanes are frozen, so the early exit check doesn't need to run
+        // every iteration
+        if ((i & (SIMD_EXIT_CHECK_INTERVAL - 1)) == 0) {
+            if (!simd_any<N, U>(active))
+                break;
+
+            // Comparing on the same interval still finds every cycle, once the
+            // saved point is SIMD_EXIT_CHECK_INTERVAL periods behind
+            if (settings.interior_checks && i > 0) {
+                for (int u = 0; u < U; ++u) {
+                    mask x_less, x_greater, y_less, y_greater;
+                    lanes::less(x_less, zx[u], saved_zx[u]);
+                    lanes::less(x_greater, saved_zx[u], zx[u]);
+                    lanes::less(y_less, zy[u], saved_zy[u]);
+                    lanes::less(y_greater, saved_zy[u], zy[u]);
+                    inside[u] |= active[u] & ~(x_less | x_greater | y_less | y_greater);
+                    active[u] &= ~inside[u];
+                }
+            }
+        }
+
+        if (settings.interior_checks && i == checkpoint) {
+            for (int u = 0; u < U; ++u) {
+                saved_zx[u] = zx[u];
+                saved_zy[u] = zy[u];
+            }
+            checkpoint <<= 1;
+        }
+
+#pragma GCC unroll 4
+        for (int u = 0; u < U; ++u) {
+            // dz = 2 * z * dz + 1 from the orbit point before the step, as in
+            // distance_derivative_step()
+            if constexpr (DISTANCE) {
+                wide wide_zx, wide_zy;
+                lanes::to_wide(wide_zx, zx[u]);
+                lanes::to_wide(wide_zy, zy[u]);
+                wide dx = wide_zx * dzx[u] - wide_zy * dzy[u];
+                wide dy = wide_zx * dzy[u] + wide_zy * dzx[u];
+                lanes::blend_wide(dzx[u], active[u], dx + dx + 1.0);
+                lanes::blend_wide(dzy[u], active[u], dy + dy);
+            }
+
+            // 2 * zx * zy as a sum, which is exact and cheaper than a product
+            // for number types made of several doubles
+            vec zxy = zx[u] * zy[u];
+            vec next_zy = zxy + zxy + cy[u];
+            vec next_zx = zx2[u] - zy2[u] + cx[u];
+            lanes::blend(zy[u], active[u], next_zy);
+            lanes::blend(zx[u], active[u], next_zx);
+
+            zx2[u] = zx[u] * zx[u];
+            zy2[u] = zy[u] * zy[u];
+
+            // Active lanes are -1
+            iter[u] -= active[u];
+        }
+    }
+
+    for (int u = 0; u < U; ++u) {
+        for (int k = 0; k < N; ++k) {
+            uint32_t lane_iter = inside[u][k] ? settings.max_iterations : (uint32_t)iter[u][k];
+            t[u * N + k] = mandelbrot_kernel_smooth_t<T>(lanes::lane(zx2[u], k) + lanes::lane(zy2[u], k), lane_iter, settings);
+
+            if constexpr (DISTANCE) {
+                double lane_zx = (double)lanes::lane(zx[u], k), lane_zy = (double)lanes::lane(zy[u], k);
+                double lane_cx = (double)lanes::lane(cx[u], k), lane_cy = (double)lanes::lane(cy[u], k);
+
+                // Lanes inside stopped at the point where their cycle was found
+                double& lane_distance = distance[u * N + k];
+                if (in_bulbs[u][k])
+                    lane_distance = main_bulbs_interior_distance(lane_cx, lane_cy);
+                else if (inside[u][k])
+                    lane_distance = interior_distance(lane_zx, lane_zy, lane_cx, lane_cy, (uint32_t)iter[u][k]);
+                else if (lane_iter < settings.max_iterations)
+                    lane_distance = escaped_distance(lane_zx, lane_zy, dzx[u][k], dzy[u][k], lane_cx, lane_cy, 1.0, lane_iter);
+                else
+                    lane_distance = 0.0;
+            }
+        }
+    }
+}
+
+/// @brief Samples the span by lane groups. The distance estimates are written to
+/// distance unless it's null
+template <typename T, int N, bool DISTANCE>
+static SIMD_INLINE void mandelbrot_batch(
+    const T* world_x,
+    const T* world_y,
+    float* t,
+    double* distance,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+    constexpr uint32_t GROUP = N * SimdLanes<T, N>::unroll;
+
+    uint32_t i = 0;
+    for (; i + GROUP <= count; i += GROUP)
+        mandelbrot_lanes<T, N, DISTANCE>(world_x + i, world_y + i, t + i, DISTANCE ? distance + i : nullptr, settings);
+
+    if (i == count)
+        return;
+
+    // Pads the last lane group by repeating the final point
+    T tail_x[GROUP], tail_y[GROUP];
+    float tail_t[GROUP];
+    double tail_distance[GROUP];
+    for (uint32_t k = 0; k < GROUP; ++k) {
+        uint32_t src = std::min(i + k, count - 1);
+        tail_x[k] = world_x[src];
+        tail_y[k] = world_y[src];
     }
+    mandelbrot_lanes<T, N, DISTANCE>(tail_x, tail_y, tail_t, tail_distance, settings);
+    memcpy(t + i, tail_t, (count - i) * sizeof(float));
+    if constexpr (DISTANCE)
+        memcpy(distance + i, tail_distance, (count - i) * sizeof(double));
+}
+
+template <typename T, int N>
+static SIMD_INLINE void mandelbrot_batch(const T* wx, const T* wy, float* t, double* distance, uint32_t count, const FractalSettings& settings)
+{
+    if (distance)
+        mandelbrot_batch<T, N, true>(wx, wy, t, distance, count, settings);
+    else
+        mandelbrot_batch<T, N, false>(wx, wy, t, nullptr, count, settings);
+}
+
+template <typename T>
+SIMD_TARGET_SSE2 static void mandelbrot_batch_sse2(const T* wx, const T* wy, float* t, double* distance, uint32_t count, const FractalSettings& settings)
+{
+    mandelbrot_batch<T, simd_lanes<T>(SimdLevel::SSE2)>(wx, wy, t, distance, count, settings);
+}
 
-    // smooth_t = iter - log2(log(length_squared) / log(4))
-    mpfr_log(log_ls, length_squared, MPFR_RNDN); // log(length_squared)
-    mpfr_div(ratio, log_ls, log_four, MPFR_RNDN); // ratio = log_ls / log(4)
-    mpfr_log2(log2_ratio, ratio, MPFR_RNDN); // log2(ratio)
-    mpfr_set_si(smooth_t, iter, MPFR_RNDN); // iter to mpfr
-    mpfr_sub(smooth_t, smooth_t, log2_ratio, MPFR_RNDN); // smooth_t = iter - log2_ratio
+template <typename T>
+SIMD_TARGET_AVX2 static void mandelbrot_batch_avx2(const T* wx, const T* wy, float* t, double* distance, uint32_t count, const FractalSettings& settings)
+{
+    mandelbrot_batch<T, simd_lanes<T>(SimdLevel::AVX2)>(wx, wy, t, distance, count, settings);
+}
+
+template <typename T>
+SIMD_TARGET_AVX512 static void mandelbrot_batch_avx512(const T* wx, const T* wy, float* t, double* distance, uint32_t count, const FractalSettings& settings)
+{
+    mandelbrot_batch<T, simd_lanes<T>(SimdLevel::AVX512)>(wx, wy, t, distance, count, settings);
+}
+#endif
+
+/// @brief Samples the span with the widest vector kernels of the CPU, for types made of
+/// floats or doubles. Other types, or other architectures, are iterated one point at a time.
+/// The distance estimates are written to distance unless it's null
+template <typename T>
+static void mandelbrot_span(
+    const T* world_x,
+    const T* world_y,
+    float* t,
+    double* distance,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+#ifdef SIMD_X86
+    switch (get_simd_level()) {
+    case SimdLevel::AVX512:
+        mandelbrot_batch_avx512(world_x, world_y, t, distance, count, settings);
+        break;
+    case SimdLevel::AVX2:
+        mandelbrot_batch_avx2(world_x, world_y, t, distance, count, settings);
+        break;
+    default:
+        mandelbrot_batch_sse2(world_x, world_y, t, distance, count, settings);
+        break;
+    }
+#else
+    for (uint32_t i = 0; i < count; ++i) {
+        if (distance)
+            t[i] = mandelbrot_iterate<T, true>(world_x[i], world_y[i], settings, distance + i);
+        else
+            t[i] = mandelbrot_iterate(world_x[i], world_y[i], settings);
+    }
+#endif
+}
 
-    // Normalize: smooth_t / settings.max_iterations
-    mpfr_set_si(max_iterations_f, settings.max_iterations, MPFR_RNDN);
-    mpfr_div(result, smooth_t, max_iterations_f, MPFR_RNDN);
-    mpfr_div(result, smooth_t, max_iterations_f, MPFR_RNDN);
+void mandelbrot_batch_sampler(
+    const number* world_x,
+    const number* world_y,
+    float* t,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+#ifdef NUMBER_SIMD
+    mandelbrot_span(world_x, world_y, t, nullptr, count, settings);
+#else
+    for (uint32_t i = 0; i < count; ++i)
+        t[i] = mandelbrot_sampler(world_x[i], world_y[i], settings);
+#endif
+}
 
-    float output = mpfr_get_flt(result, MPFR_RNDN);
+#ifndef USE_MPFR
+void mandelbrot_distance_batch_sampler(
+    const number* world_x,
+    const number* world_y,
+    float* t,
+    double* distance,
+    uint32_t count,
+    const FractalSettings& settings)
+{
+#ifdef NUMBER_SIMD
+    mandelbrot_span(world_x, world_y, t, distance, count, settings);
+#else
+    for (uint32_t i = 0; i < count; ++i)
+        t[i] = mandelbrot_iterate<number, true>(world_x[i], world_y[i], settings, distance + i);
+#endif
+}
+#endif
 
-    // Clear all variables
-    mpfr_clears(two, four, zx, zy, zx2, zy2, xtemp, length_squared,
-        log_ls, log_four, ratio, log2_ratio,
-        smooth_t, max_iterations_f, result, (mpfr_ptr)0);
+#ifdef PRECISION_TIER_FLOAT
+void mandelbrot_batch_sampler(const float* world_x, const float* world_y, float* t, uint32_t count, const FractalSettings& settings)
+{
+    mandelbrot_span(world_x, world_y, t, nullptr, count, settings);
+}
+#endif
 
-    return output;
+#ifdef PRECISION_TIER_DOUBLE
+void mandelbrot_batch_sampler(const double* world_x, const double* world_y, float* t, uint32_t count, const FractalSettings& settings)
+{
+    mandelbrot_span(world_x, world_y, t, nullptr, count, settings);
 }
+#endif
 
-#endif
\ No newline at end of file
+#ifdef PRECISION_TIER_EXTENDED
+void mandelbrot_batch_sampler(const double_double* world_x, const double_double* world_y, float* t, uint32_t count, const FractalSettings& settings)
+{
+    mandelbrot_span(world_x, world_y, t, nullptr, count, settings);
+}
+#endif
@@ -0,0 +1,183 @@
+#ifdef USE_MP_ARENA
+#include "mp_arena.h"
+#include "logging.h"
+#include <gmp.h>
+#include <mpfr.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+static constexpr size_t CHUNK_SIZE = MP_ARENA_CHUNK_SIZE;
+static constexpr size_t CHUNK_COUNT = MP_ARENA_CHUNK_COUNT;
+static constexpr size_t ALIGNMENT = 16;
+
+// Larger allocations go to the system allocator, so a chunk holds many limb arrays
+static constexpr size_t MAX_ARENA_ALLOCATION = CHUNK_SIZE / 8;
+
+// Reserved once, pages are only backed when first touched
+static uint8_t* s_region = nullptr;
+
+// Live allocations of each chunk, plus one while a thread bumps from it
+static std::atomic<int32_t> s_live_allocations[CHUNK_COUNT];
+
+static std::mutex s_free_chunks_mutex;
+static std::vector<uint32_t> s_free_chunks;
+
+static std::once_flag s_install_flag;
+static void* (*s_system_alloc)(size_t);
+static void* (*s_system_realloc)(void*, size_t, size_t);
+static void (*s_system_free)(void*, size_t);
+
+struct ThreadArena {
+    /// @brief Active scopes of the thread, allocations only use the arena when positive
+    int depth = 0;
+    int64_t chunk = -1;
+    size_t offset = 0;
+    MpArenaStats counters;
+};
+
+static thread_local ThreadArena t_arena;
+
+static bool in_region(const void* ptr)
+{
+    const uint8_t* p = (const uint8_t*)ptr;
+    return s_region && p >= s_region && p < s_region + CHUNK_SIZE * CHUNK_COUNT;
+}
+
+static void release_chunk(uint32_t chunk)
+{
+    if (s_live_allocations[chunk].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(s_free_chunks_mutex);
+        s_free_chunks.push_back(chunk);
+    }
+}
+
+/// @brief Stops bumping from the current chunk, which is recycled once its allocations are freed
+static void retire_chunk(ThreadArena& arena)
+{
+    if (arena.chunk >= 0) {
+        release_chunk((uint32_t)arena.chunk);
+        arena.chunk = -1;
+    }
+}
+
+static bool acquire_chunk(ThreadArena& arena)
+{
+    std::lock_guard<std::mutex> lock(s_free_chunks_mutex);
+    if (s_free_chunks.empty())
+        return false;
+
+    arena.chunk = s_free_chunks.back();
+    arena.offset = 0;
+    s_free_chunks.pop_back();
+    s_live_allocations[arena.chunk].store(1, std::memory_order_relaxed);
+    return true;
+}
+
+static void* arena_alloc(size_t size)
+{
+    ThreadArena& arena = t_arena;
+    if (arena.depth == 0)
+        return s_system_alloc(size);
+
+    size_t aligned_size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    arena.counters.bytes += aligned_size;
+    arena.counters.allocations++;
+
+    if (aligned_size <= MAX_ARENA_ALLOCATION) {
+        if (arena.chunk < 0 || arena.offset + aligned_size > CHUNK_SIZE) {
+            retire_chunk(arena);
+            acquire_chunk(arena);
+        }
+
+        if (arena.chunk >= 0) {
+            void* ptr = s_region + arena.chunk * CHUNK_SIZE + arena.offset;
+            arena.offset += aligned_size;
+            s_live_allocations[arena.chunk].fetch_add(1, std::memory_order_relaxed);
+            return ptr;
+        }
+    }
+
+    arena.counters.system_allocations++;
+    return s_system_alloc(size);
+}
+
+static void arena_free(void* ptr, size_t size)
+{
+    if (in_region(ptr))
+        release_chunk((uint32_t)(((uint8_t*)ptr - s_region) / CHUNK_SIZE));
+    else
+        s_system_free(ptr, size);
+}
+
+static void* arena_realloc(void* ptr, size_t old_size, size_t new_size)
+{
+    // Memory from the system allocator stays there
+    if (!in_region(ptr))
+        return s_system_realloc(ptr, old_size, new_size);
+
+    if (new_size <= old_size)
+        return ptr;
+
+    void* result = arena_alloc(new_size);
+    memcpy(result, ptr, old_size);
+    arena_free(ptr, old_size);
+    return result;
+}
+
+static void install_arena()
+{
+    void* region = mmap(
+        nullptr,
+        CHUNK_SIZE * CHUNK_COUNT,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+        -1,
+        0);
+
+    if (region == MAP_FAILED) {
+        LOG_WARNING("Unable to reserve the GMP arena. Using the system allocator");
+        return;
+    }
+
+    s_region = (uint8_t*)region;
+
+    // Lower chunks are handed out first
+    s_free_chunks.reserve(CHUNK_COUNT);
+    for (size_t i = CHUNK_COUNT; i > 0; --i)
+        s_free_chunks.push_back((uint32_t)(i - 1));
+
+    mp_get_memory_functions(&s_system_alloc, &s_system_realloc, &s_system_free);
+    mp_set_memory_functions(arena_alloc, arena_realloc, arena_free);
+}
+
+MpArenaScope::MpArenaScope()
+{
+    std::call_once(s_install_flag, install_arena);
+    start = t_arena.counters;
+    t_arena.depth++;
+}
+
+MpArenaScope::~MpArenaScope()
+{
+    if (--t_arena.depth > 0)
+        return;
+
+    // MPFR keeps constants and a pool of integers between calls, which would pin
+    // the chunk they were allocated in
+    mpfr_free_cache();
+    retire_chunk(t_arena);
+}
+
+MpArenaStats MpArenaScope::stats() const
+{
+    MpArenaStats result;
+    result.bytes = t_arena.counters.bytes - start.bytes;
+    result.allocations = t_arena.counters.allocations - start.allocations;
+    result.system_allocations = t_arena.counters.system_allocations - start.system_allocations;
+    return result;
+}
+
+#endif
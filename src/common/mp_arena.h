@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+
+// Arena for the limbs of GMP and MPFR, enabled with USE_MP_ARENA in the MPFR build.
+// Memory is handed out from fixed size chunks of a region reserved once. A chunk
+// goes back to the pool as soon as every allocation made from it was freed, so
+// the limbs of a tile are recycled in bulk when its numbers are destroyed
+
+#ifndef MP_ARENA_CHUNK_SIZE
+#define MP_ARENA_CHUNK_SIZE (256 * 1024)
+#endif
+
+#ifndef MP_ARENA_CHUNK_COUNT
+#define MP_ARENA_CHUNK_COUNT 1024
+#endif
+
+/// @brief Allocations requested through GMP by the thread of a scope
+struct MpArenaStats {
+    uint64_t bytes = 0;
+    uint64_t allocations = 0;
+
+    /// @brief Allocations too large for a chunk, or made while the region was exhausted
+    uint64_t system_allocations = 0;
+};
+
+/// @brief While alive, GMP and MPFR allocations of the calling thread come from the
+/// arena. The allocator is installed by the first scope and kept afterwards, since
+/// limbs allocated in a scope may be freed after it. Memory that wasn't allocated by
+/// the arena is still released with the previous GMP functions
+class MpArenaScope {
+public:
+    MpArenaScope();
+    ~MpArenaScope();
+
+    MpArenaScope(const MpArenaScope&) = delete;
+    MpArenaScope& operator=(const MpArenaScope&) = delete;
+
+    /// @brief Counters since the scope was created
+    MpArenaStats stats() const;
+
+private:
+    MpArenaStats start;
+};
@@ -4,9 +4,16 @@
 
 #include <mpfr.h>
 #include <vector>
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
 #include <string.h>
+#include <utility>
+
+#define NUMBER_SERIAL_SIZE 2048
 
-#define NUMBER_SERIAL_SIZE 512
+// Grows with the digits of the coordinates, so it has no fixed bound
+#define NUMBER_PRECISION_BITS 0x7fffffff
 #define DEFAULT_PRECISION 256
 
 class number {
@@ -29,12 +36,26 @@ public:
         return number(precision);
     }
 
+    /// @brief Binary operations keep the widest precision of both operands, so values
+    /// parsed with more digits than DEFAULT_PRECISION don't lose them
+    mpfr_prec_t result_precision(const number& rhs) const
+    {
+        return std::max(mpfr_get_prec(n_ptr), mpfr_get_prec(rhs.n_ptr));
+    }
+
     number(const number& other)
     {
         mpfr_init2(n_ptr, mpfr_get_prec(other.n_ptr));
         mpfr_set(n_ptr, other.n_ptr, MPFR_RNDN);
     }
 
+    /// @brief Takes over the limbs of other, which is left without any to free
+    number(number&& other) noexcept
+    {
+        *n_ptr = *other.n_ptr;
+        other.n_ptr->_mpfr_d = nullptr;
+    }
+
     number(double d, unsigned int precision = DEFAULT_PRECISION)
     {
         mpfr_init2(n_ptr, precision);
@@ -49,29 +70,43 @@ public:
 
     ~number()
     {
-        mpfr_clear(n_ptr);
+        if (is_initialized())
+            mpfr_clear(n_ptr);
     }
 
+    /// @brief False once the value was moved from. It can then only be assigned or destroyed
+    bool is_initialized() const { return n_ptr->_mpfr_d != nullptr; }
+
     number& operator=(const number& other)
     {
         if (this != &other) {
-            if (mpfr_get_prec(n_ptr) != mpfr_get_prec(other.n_ptr)) {
-                mpfr_clear(n_ptr);
+            if (!is_initialized())
                 mpfr_init2(n_ptr, mpfr_get_prec(other.n_ptr));
-            }
+            else if (mpfr_get_prec(n_ptr) != mpfr_get_prec(other.n_ptr))
+                mpfr_set_prec(n_ptr, mpfr_get_prec(other.n_ptr));
             mpfr_set(n_ptr, other.n_ptr, MPFR_RNDN);
         }
         return *this;
     }
 
+    number& operator=(number&& other) noexcept
+    {
+        mpfr_swap(n_ptr, other.n_ptr);
+        return *this;
+    }
+
     number& operator=(double d)
     {
+        if (!is_initialized())
+            mpfr_init2(n_ptr, DEFAULT_PRECISION);
         mpfr_set_d(n_ptr, d, MPFR_RNDN);
         return *this;
     }
 
     number& operator=(int i)
     {
+        if (!is_initialized())
+            mpfr_init2(n_ptr, DEFAULT_PRECISION);
         mpfr_set_si(n_ptr, i, MPFR_RNDN);
         return *this;
     }
@@ -91,34 +126,70 @@ public:
         return result;
     }
 
-    number operator+(const number& rhs) const
+    number operator+(const number& rhs) const&
     {
-        number result = from_precision(mpfr_get_prec(n_ptr));
+        number result = from_precision(result_precision(rhs));
         mpfr_add(result.n_ptr, n_ptr, rhs.n_ptr, MPFR_RNDN);
         return result;
     }
 
-    number operator-(const number& rhs) const
+    number operator-(const number& rhs) const&
     {
-        number result = from_precision(mpfr_get_prec(n_ptr));
+        number result = from_precision(result_precision(rhs));
         mpfr_sub(result.n_ptr, n_ptr, rhs.n_ptr, MPFR_RNDN);
         return result;
     }
 
-    number operator*(const number& rhs) const
+    number operator*(const number& rhs) const&
     {
-        number result = from_precision(mpfr_get_prec(n_ptr));
+        number result = from_precision(result_precision(rhs));
         mpfr_mul(result.n_ptr, n_ptr, rhs.n_ptr, MPFR_RNDN);
         return result;
     }
 
-    number operator/(const number& rhs) const
+    number operator/(const number& rhs) const&
     {
-        number result = from_precision(mpfr_get_prec(n_ptr));
+        number result = from_precision(result_precision(rhs));
         mpfr_div(result.n_ptr, n_ptr, rhs.n_ptr, MPFR_RNDN);
         return result;
     }
 
+    // Temporaries are reused as the result, so chained expressions such as
+    // a * b + c only allocate once
+    number operator+(const number& rhs) && { return std::move(*this += rhs); }
+    number operator-(const number& rhs) && { return std::move(*this -= rhs); }
+    number operator*(const number& rhs) && { return std::move(*this *= rhs); }
+    number operator/(const number& rhs) && { return std::move(*this /= rhs); }
+
+    // In place operations, which don't allocate unless rhs is more precise
+    number& operator+=(const number& rhs)
+    {
+        widen_precision(rhs);
+        mpfr_add(n_ptr, n_ptr, rhs.n_ptr, MPFR_RNDN);
+        return *this;
+    }
+
+    number& operator-=(const number& rhs)
+    {
+        widen_precision(rhs);
+        mpfr_sub(n_ptr, n_ptr, rhs.n_ptr, MPFR_RNDN);
+        return *this;
+    }
+
+    number& operator*=(const number& rhs)
+    {
+        widen_precision(rhs);
+        mpfr_mul(n_ptr, n_ptr, rhs.n_ptr, MPFR_RNDN);
+        return *this;
+    }
+
+    number& operator/=(const number& rhs)
+    {
+        widen_precision(rhs);
+        mpfr_div(n_ptr, n_ptr, rhs.n_ptr, MPFR_RNDN);
+        return *this;
+    }
+
     // Comparison operators
     bool operator==(const number& rhs) const { return mpfr_cmp(n_ptr, rhs.n_ptr) == 0; }
     bool operator!=(const number& rhs) const { return mpfr_cmp(n_ptr, rhs.n_ptr) != 0; }
@@ -133,24 +204,90 @@ public:
 
     void serialize(char* buffer) const
     {
-        constexpr int DIGITS = 100;
+        // As many digits as the precision holds, which deserialize() maps back to the same precision
+        int digits = (int)floor(mpfr_get_prec(n_ptr) * 0.301029995663981);
         char* str = nullptr;
 
-        mpfr_asprintf(&str, "%.*Rf", DIGITS, n_ptr);
+        int length = mpfr_asprintf(&str, "%.*Re", digits - 1, n_ptr);
+
+        // Drop the digits that don't fit next to the sign and exponent, rather than
+        // cutting the exponent off. Rounding can carry into the exponent, so check again
+        while (length >= NUMBER_SERIAL_SIZE && digits > 1) {
+            digits = std::max(1, digits - (length - NUMBER_SERIAL_SIZE + 1));
+            mpfr_free_str(str);
+            str = nullptr;
+            length = mpfr_asprintf(&str, "%.*Re", digits - 1, n_ptr);
+        }
 
-        if (!str) {
+        if (length < 0) {
             buffer[0] = '\0';
             return;
         }
 
         memset(buffer, 0, NUMBER_SERIAL_SIZE);
-        strncpy(buffer, str, NUMBER_SERIAL_SIZE - 1);
+        memcpy(buffer, str, std::min(length, NUMBER_SERIAL_SIZE - 1));
         mpfr_free_str(str);
     }
+
+    /// @brief Parses a decimal string. The precision grows past DEFAULT_PRECISION to
+    /// hold every significant digit, which deep zoom coordinates need
     void deserialize(const char* data)
     {
+        size_t digits = 0;
+        for (const char* c = data; *c && *c != 'e' && *c != 'E'; ++c)
+            digits += isdigit(*c) != 0;
+
+        mpfr_prec_t precision = (mpfr_prec_t)ceil(digits * 3.321928094887362);
+        mpfr_set_prec(n_ptr, std::max(precision, (mpfr_prec_t)DEFAULT_PRECISION));
         mpfr_set_str(n_ptr, data, 10, MPFR_RNDN);
     }
+
+private:
+    /// @brief Matches result_precision() for in place operations. Widening is exact
+    void widen_precision(const number& rhs)
+    {
+        if (mpfr_get_prec(rhs.n_ptr) > mpfr_get_prec(n_ptr))
+            mpfr_prec_round(n_ptr, mpfr_get_prec(rhs.n_ptr), MPFR_RNDN);
+    }
+};
+
+/// @brief Fixed set of MPFR variables that outlives a single sample. Samplers keep
+/// one per thread, so the variables are initialized once instead of on every call
+template <int COUNT>
+class MpfrScratch {
+public:
+    MpfrScratch()
+        : precision(DEFAULT_PRECISION)
+    {
+        for (int i = 0; i < COUNT; ++i)
+            mpfr_init2(values[i], precision);
+    }
+
+    ~MpfrScratch()
+    {
+        for (int i = 0; i < COUNT; ++i)
+            mpfr_clear(values[i]);
+    }
+
+    MpfrScratch(const MpfrScratch&) = delete;
+    MpfrScratch& operator=(const MpfrScratch&) = delete;
+
+    /// @brief Only reallocates when the precision changes, which is once per render
+    void set_precision(mpfr_prec_t new_precision)
+    {
+        if (new_precision == precision)
+            return;
+
+        for (int i = 0; i < COUNT; ++i)
+            mpfr_set_prec(values[i], new_precision);
+        precision = new_precision;
+    }
+
+    mpfr_ptr operator[](int i) { return values[i]; }
+
+private:
+    mpfr_t values[COUNT];
+    mpfr_prec_t precision;
 };
 
 #define LOG_NUM(X) X.log()
@@ -162,16 +299,83 @@ public:
 #elif PRECISION_128
 #include <quadmath.h>
 typedef long double number;
+#define NUMBER_PRECISION_BITS 64
 #define NUMBER_SERIAL_SIZE 128
 #define SERIALIZE_NUM(X, Y) sprintf(Y, "%.36Lf", X)
 #define DESERIALIZE_NUM(X, Y) sscanf(Y, "%Lf", &X)
 #define LOG_NUM(X) logq(X)
 #define LOG2_NUM(X) log2q(X)
 
+#elif PRECISION_DOUBLE_DOUBLE
+#define NUMBER_SERIAL_SIZE 128
+#include "numbers/double_double.h"
+typedef double_double number;
+#define NUMBER_PRECISION_BITS 106
+
+// Made of doubles with branch free arithmetic, so it can be iterated with vector instructions
+#define NUMBER_SIMD 1
+
+#define LOG_NUM(X) (X).log()
+#define LOG2_NUM(X) (X).log2()
+
+#define SERIALIZE_NUM(X, Y) (X).serialize(Y)
+#define DESERIALIZE_NUM(X, Y) (X).deserialize(Y)
+
+#elif PRECISION_QUAD_DOUBLE
+#define NUMBER_SERIAL_SIZE 128
+#include "numbers/quad_double.h"
+typedef quad_double number;
+#define NUMBER_PRECISION_BITS 212
+
+// Made of doubles with branch free arithmetic, so it can be iterated with vector instructions
+#define NUMBER_SIMD 1
+
+#define LOG_NUM(X) (X).log()
+#define LOG2_NUM(X) (X).log2()
+
+#define SERIALIZE_NUM(X, Y) (X).serialize(Y)
+#define DESERIALIZE_NUM(X, Y) (X).deserialize(Y)
+
+#elif PRECISION_FLOATEXP
+#define NUMBER_SERIAL_SIZE 128
+#include "numbers/floatexp.h"
+typedef floatexp number;
+#define NUMBER_PRECISION_BITS 53
+
+#define LOG_NUM(X) (X).log()
+#define LOG2_NUM(X) (X).log2()
+
+#define SERIALIZE_NUM(X, Y) (X).serialize(Y)
+#define DESERIALIZE_NUM(X, Y) (X).deserialize(Y)
+
+#elif PRECISION_FIXED_POINT
+#define NUMBER_SERIAL_SIZE 128
+#include "numbers/fixed_point.h"
+
+#ifndef FIXED_POINT_LIMBS
+#define FIXED_POINT_LIMBS 4
+#endif
+typedef fixed_point<FIXED_POINT_LIMBS> number;
+#define NUMBER_PRECISION_BITS (64 * (FIXED_POINT_LIMBS - 1))
+
+// Zooms go past the integer range of fixed point, so they keep an extended exponent
+typedef floatexp zoom_number;
+#define NUMBER_HAS_ZOOM_TYPE 1
+
+#define LOG_NUM(X) (X).log()
+#define LOG2_NUM(X) (X).log2()
+
+#define SERIALIZE_NUM(X, Y) (X).serialize(Y)
+#define DESERIALIZE_NUM(X, Y) (X).deserialize(Y)
+
 #elif PRECISION_32
 #include <math.h>
 typedef float number;
+#define NUMBER_PRECISION_BITS 24
 #define NUMBER_SERIAL_SIZE 128
+
+// Native floating point types can be iterated with vector instructions
+#define NUMBER_SIMD 1
 #define SERIALIZE_NUM(X, Y) sprintf(Y, "%.9g", X)
 #define DESERIALIZE_NUM(X, Y) sscanf(Y, "%f", &X)
 #define LOG_NUM(X) logf(X)
@@ -180,12 +384,20 @@ typedef float number;
 #else
 #include <math.h>
 typedef double number;
+#define NUMBER_PRECISION_BITS 53
 #define NUMBER_SERIAL_SIZE 128
 
+// Native floating point types can be iterated with vector instructions
+#define NUMBER_SIMD 1
+
 #define SERIALIZE_NUM(X, Y) sprintf(Y, "%.17g", X)
 #define DESERIALIZE_NUM(X, Y) sscanf(Y, "%lf", &X)
 
 #define LOG_NUM(X) log(X)
 #define LOG2_NUM(X) log2(X)
 
-#endif
\ No newline at end of file
+#endif
+
+#ifndef NUMBER_HAS_ZOOM_TYPE
+typedef number zoom_number;
+#endif
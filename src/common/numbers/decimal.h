@@ -0,0 +1,119 @@
+#pragma once
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// Decimal string conversions shared by the number classes that aren't backed by
+// a library. T needs the arithmetic and comparison operators, construction from
+// double, an explicit cast to double and log()
+
+namespace decimal {
+
+/// @brief 10^e computed with binary exponentiation in the precision of T
+template <typename T>
+T pow10(long long e)
+{
+    T result(1.0);
+    T base(10.0);
+    unsigned long long n = e < 0 ? -e : e;
+
+    while (n) {
+        if (n & 1)
+            result = result * base;
+        base = base * base;
+        n >>= 1;
+    }
+    return e < 0 ? T(1.0) / result : result;
+}
+
+/// @brief Writes value in scientific notation with the given significant digits
+template <typename T>
+void to_string(const T& value, int digits, char* buffer, size_t size)
+{
+    T r = value;
+    bool negative = r < T(0.0);
+    if (negative)
+        r = -r;
+
+    // The logarithm is also finite past the range of double for wide exponent types
+    double log_r = r == T(0.0) ? 0.0 : (double)r.log();
+    if (r == T(0.0) || !isfinite(log_r)) {
+        snprintf(buffer, size, "%.17g", (double)value);
+        return;
+    }
+
+    // Scales into [1, 10)
+    long long e = (long long)floor(log_r / M_LN10);
+    r = e >= 0 ? r / pow10<T>(e) : r * pow10<T>(-e);
+    if (r >= T(10.0)) {
+        r = r / T(10.0);
+        ++e;
+    } else if (r < T(1.0)) {
+        r = r * T(10.0);
+        --e;
+    }
+
+    char* out = buffer;
+    char* end = buffer + size - 24;
+    if (negative)
+        *out++ = '-';
+
+    for (int i = 0; i < digits && out < end; ++i) {
+        int d = (int)(double)r;
+
+        // The leading component can round up to the next integer
+        if (r < T((double)d))
+            --d;
+        d = d < 0 ? 0 : d > 9 ? 9 : d;
+
+        *out++ = '0' + d;
+        if (i == 0)
+            *out++ = '.';
+
+        r = (r - T((double)d)) * T(10.0);
+    }
+
+    snprintf(out, buffer + size - out, "e%lld", e);
+}
+
+/// @brief Parses a decimal number such as "-0.743643887037158704752191506114774" or "1e40"
+template <typename T>
+bool from_string(const char* str, T& value)
+{
+    while (isspace(*str))
+        ++str;
+
+    bool negative = *str == '-';
+    if (*str == '-' || *str == '+')
+        ++str;
+
+    T r(0.0);
+    long long exponent = 0;
+    bool any_digit = false;
+    bool fraction = false;
+
+    for (; *str; ++str) {
+        if (isdigit(*str)) {
+            r = r * T(10.0) + T((double)(*str - '0'));
+            exponent -= fraction;
+            any_digit = true;
+        } else if (*str == '.' && !fraction) {
+            fraction = true;
+        } else {
+            break;
+        }
+    }
+
+    if (*str == 'e' || *str == 'E')
+        exponent += atoll(str + 1);
+
+    if (!any_digit)
+        return false;
+
+    r = exponent >= 0 ? r * pow10<T>(exponent) : r / pow10<T>(-exponent);
+    value = negative ? -r : r;
+    return true;
+}
+
+}
\ No newline at end of file
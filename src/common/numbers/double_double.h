@@ -0,0 +1,157 @@
+#pragma once
+#include "multi_double.h"
+#include "decimal.h"
+#include "../simd.h"
+
+/// @brief Unevaluated sum of two doubles, giving about 106 bits of mantissa
+/// with the exponent range of double. D is double, or a vector of doubles when
+/// the number is iterated by the SIMD kernels
+template <typename D>
+class basic_double_double {
+public:
+    D hi, lo;
+
+    basic_double_double()
+        : hi()
+        , lo()
+    {
+    }
+
+    basic_double_double(double d)
+        : hi(d)
+        , lo()
+    {
+    }
+
+    basic_double_double(const D& h, const D& l)
+        : hi(h)
+        , lo(l)
+    {
+    }
+
+    SIMD_INLINE basic_double_double operator-() const { return basic_double_double(-hi, -lo); }
+
+    SIMD_INLINE basic_double_double operator+(const basic_double_double& rhs) const
+    {
+        D s1, s2, t1, t2;
+        multi_double::two_sum(hi, rhs.hi, s1, s2);
+        multi_double::two_sum(lo, rhs.lo, t1, t2);
+        s2 += t1;
+        multi_double::quick_two_sum(s1, s2, s1, s2);
+        s2 += t2;
+        multi_double::quick_two_sum(s1, s2, s1, s2);
+        return basic_double_double(s1, s2);
+    }
+
+    SIMD_INLINE basic_double_double operator-(const basic_double_double& rhs) const
+    {
+        return *this + (-rhs);
+    }
+
+    SIMD_INLINE basic_double_double operator*(const basic_double_double& rhs) const
+    {
+        D p1, p2;
+        multi_double::two_prod(hi, rhs.hi, p1, p2);
+        p2 += hi * rhs.lo + lo * rhs.hi;
+        multi_double::quick_two_sum(p1, p2, p1, p2);
+        return basic_double_double(p1, p2);
+    }
+
+    basic_double_double operator/(const basic_double_double& rhs) const
+    {
+        // Long division, one double of quotient at a time
+        D q1 = hi / rhs.hi;
+        basic_double_double r = *this - rhs * basic_double_double(q1, D());
+
+        D q2 = r.hi / rhs.hi;
+        r = r - rhs * basic_double_double(q2, D());
+
+        D q3 = r.hi / rhs.hi;
+
+        multi_double::quick_two_sum(q1, q2, q1, q2);
+        return basic_double_double(q1, q2) + basic_double_double(q3, D());
+    }
+
+    basic_double_double& operator+=(const basic_double_double& rhs) { return *this = *this + rhs; }
+    basic_double_double& operator-=(const basic_double_double& rhs) { return *this = *this - rhs; }
+    basic_double_double& operator*=(const basic_double_double& rhs) { return *this = *this * rhs; }
+    basic_double_double& operator/=(const basic_double_double& rhs) { return *this = *this / rhs; }
+
+    // Logarithms are only used to smooth the escape count, so one correction
+    // term over the double logarithm is precise enough
+    basic_double_double log() const { return ::log(hi) + lo / hi; }
+    basic_double_double log2() const { return ::log2(hi) + lo / (hi * M_LN2); }
+
+    // Comparison operators
+    bool operator==(const basic_double_double& rhs) const { return hi == rhs.hi && lo == rhs.lo; }
+    bool operator!=(const basic_double_double& rhs) const { return !(*this == rhs); }
+    bool operator<(const basic_double_double& rhs) const { return hi < rhs.hi || (hi == rhs.hi && lo < rhs.lo); }
+    bool operator<=(const basic_double_double& rhs) const { return !(rhs < *this); }
+    bool operator>(const basic_double_double& rhs) const { return rhs < *this; }
+    bool operator>=(const basic_double_double& rhs) const { return !(*this < rhs); }
+
+    // Casts
+    explicit operator double() const { return hi + lo; }
+    explicit operator float() const { return (float)(hi + lo); }
+
+    void serialize(char* buffer) const
+    {
+        decimal::to_string(*this, 34, buffer, NUMBER_SERIAL_SIZE);
+    }
+
+    void deserialize(const char* data)
+    {
+        decimal::from_string(data, *this);
+    }
+};
+
+typedef basic_double_double<double> double_double;
+
+/// @brief Lanes of double-double numbers, stored as a vector per component
+template <int N>
+struct SimdLanes<double_double, N> {
+    typedef typename SimdLanes<double, N>::vec component;
+    typedef basic_double_double<component> vec;
+    typedef typename SimdLanes<double, N>::mask mask;
+    typedef component wide;
+
+    static constexpr int unroll = SIMD_UNROLL;
+
+    static SIMD_INLINE void load(vec& dst, const double_double* src)
+    {
+        for (int k = 0; k < N; ++k) {
+            dst.hi[k] = src[k].hi;
+            dst.lo[k] = src[k].lo;
+        }
+    }
+
+    static SIMD_INLINE void broadcast(vec& dst, const double_double& value)
+    {
+        dst.hi = component {} + value.hi;
+        dst.lo = component {} + value.lo;
+    }
+
+    static SIMD_INLINE void less(mask& dst, const vec& a, const vec& b)
+    {
+        dst = (a.hi < b.hi) | ((a.hi == b.hi) & (a.lo < b.lo));
+    }
+
+    static SIMD_INLINE void blend(vec& dst, const mask& m, const vec& src)
+    {
+        dst.hi = m ? src.hi : dst.hi;
+        dst.lo = m ? src.lo : dst.lo;
+    }
+
+    static SIMD_INLINE double_double lane(const vec& v, int k) { return double_double(v.hi[k], v.lo[k]); }
+
+    /// @brief Leading component of each lane
+    static SIMD_INLINE void to_wide(wide& dst, const vec& v) { dst = v.hi; }
+    static SIMD_INLINE void blend_wide(wide& dst, const mask& m, const wide& src) { dst = m ? src : dst; }
+};
+
+/// @brief Each lane holds two doubles, so a register fits as many lanes as with double
+template <>
+constexpr int simd_lanes<double_double>(SimdLevel level)
+{
+    return simd_lanes<double>(level);
+}
\ No newline at end of file
@@ -0,0 +1,337 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include "floatexp.h"
+
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+
+/// @brief Signed fixed point number over LIMBS 64 bit limbs in two's complement.
+/// The top limb is the integer part and the others the fraction, so the range is
+/// about +-9.2e18 with a resolution of 2^(-64 * (LIMBS - 1)). Escape time iteration
+/// stays within a few units of the origin, so there's no exponent to track and the
+/// arithmetic reduces to add with carry chains and __int128 products
+template <int LIMBS>
+class fixed_point {
+    static_assert(LIMBS >= 2, "fixed_point needs an integer limb and at least one fraction limb");
+
+public:
+    /// @brief Least significant first
+    uint64_t limbs[LIMBS];
+
+    fixed_point()
+        : limbs()
+    {
+    }
+
+    fixed_point(double d)
+    {
+        from_double(d);
+    }
+
+    fixed_point operator-() const
+    {
+        fixed_point result;
+        unsigned char borrow = 0;
+        for (int i = 0; i < LIMBS; ++i)
+            borrow = sub_borrow(borrow, 0, limbs[i], result.limbs[i]);
+        return result;
+    }
+
+    fixed_point operator+(const fixed_point& rhs) const
+    {
+        fixed_point result;
+        unsigned char carry = 0;
+        for (int i = 0; i < LIMBS; ++i)
+            carry = add_carry(carry, limbs[i], rhs.limbs[i], result.limbs[i]);
+        return result;
+    }
+
+    fixed_point operator-(const fixed_point& rhs) const
+    {
+        fixed_point result;
+        unsigned char borrow = 0;
+        for (int i = 0; i < LIMBS; ++i)
+            borrow = sub_borrow(borrow, limbs[i], rhs.limbs[i], result.limbs[i]);
+        return result;
+    }
+
+    fixed_point operator*(const fixed_point& rhs) const
+    {
+        // Column by column product of the limbs as unsigned integers, accumulated in
+        // three words. Columns below LIMBS - 2 are skipped, since only their carries
+        // would reach the kept limbs, so the result is truncated to within an ulp
+        // at about half the products
+        fixed_point result;
+        uint64_t low = 0, high = 0, carries = 0;
+#pragma GCC unroll 16
+        for (int column = LIMBS - 2; column <= 2 * LIMBS - 2; ++column) {
+#pragma GCC unroll 8
+            for (int i = column < LIMBS ? 0 : column - LIMBS + 1; i <= column && i < LIMBS; ++i) {
+                unsigned __int128 product = (unsigned __int128)limbs[i] * rhs.limbs[column - i];
+                unsigned char carry = add_carry(0, low, (uint64_t)product, low);
+                carry = add_carry(carry, high, (uint64_t)(product >> 64), high);
+                carries += carry;
+            }
+
+            if (column >= LIMBS - 1)
+                result.limbs[column - LIMBS + 1] = low;
+            low = high;
+            high = carries;
+            carries = 0;
+        }
+
+        // Two's complement correction. A negative operand reads as 2^(64 * LIMBS) more
+        // than its value, which adds the other operand one limb above the result
+        uint64_t lhs_mask = is_negative() ? ~0ull : 0;
+        uint64_t rhs_mask = rhs.is_negative() ? ~0ull : 0;
+        unsigned char borrow = 0;
+        for (int i = 1; i < LIMBS; ++i)
+            borrow = sub_borrow(borrow, result.limbs[i], rhs.limbs[i - 1] & lhs_mask, result.limbs[i]);
+        borrow = 0;
+        for (int i = 1; i < LIMBS; ++i)
+            borrow = sub_borrow(borrow, result.limbs[i], limbs[i - 1] & rhs_mask, result.limbs[i]);
+
+        return result;
+    }
+
+    /// @brief Refines the double quotient with the remainder, gaining 52 bits per step.
+    /// Slower than the other operations, but it's only used outside the iteration
+    fixed_point operator/(const fixed_point& rhs) const
+    {
+        double divisor = (double)rhs;
+        fixed_point quotient = (double)*this / divisor;
+        for (int step = 0; step < (64 * LIMBS + 51) / 52; ++step) {
+            fixed_point remainder = *this - rhs * quotient;
+            quotient = quotient + fixed_point((double)remainder / divisor);
+        }
+        return quotient;
+    }
+
+    fixed_point& operator+=(const fixed_point& rhs) { return *this = *this + rhs; }
+    fixed_point& operator-=(const fixed_point& rhs) { return *this = *this - rhs; }
+    fixed_point& operator*=(const fixed_point& rhs) { return *this = *this * rhs; }
+    fixed_point& operator/=(const fixed_point& rhs) { return *this = *this / rhs; }
+
+    /// @brief Division by a value with an extended exponent, such as the camera zoom,
+    /// which doesn't fit in the integer limb. With rhs = M * 2^-shift for a 53 bit
+    /// integer M, the quotient is (this * 2^shift) / M
+    fixed_point& operator/=(const floatexp& rhs)
+    {
+        bool negative = is_negative() != (rhs.mantissa < 0.0);
+        fixed_point magnitude = abs();
+        uint64_t divisor = (uint64_t)ldexp(fabs(rhs.mantissa), 52);
+        int64_t shift = 52 - rhs.exponent;
+
+        // Shifting left before dividing keeps the low bits, shifting right after
+        // only drops bits below the resolution
+        if (shift > 0)
+            magnitude.shift(shift);
+        magnitude.divide_small(divisor);
+        if (shift < 0)
+            magnitude.shift(shift);
+
+        *this = negative ? -magnitude : magnitude;
+        return *this;
+    }
+
+    // Math operations. Only used to smooth the escape count, so double is enough
+    fixed_point log() const { return ::log((double)*this); }
+    fixed_point log2() const { return ::log2((double)*this); }
+
+    // Comparison operators
+    bool operator==(const fixed_point& rhs) const
+    {
+        for (int i = 0; i < LIMBS; ++i) {
+            if (limbs[i] != rhs.limbs[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const fixed_point& rhs) const { return !(*this == rhs); }
+
+    bool operator<(const fixed_point& rhs) const
+    {
+        if (limbs[LIMBS - 1] != rhs.limbs[LIMBS - 1])
+            return (int64_t)limbs[LIMBS - 1] < (int64_t)rhs.limbs[LIMBS - 1];
+
+        for (int i = LIMBS - 2; i >= 0; --i) {
+            if (limbs[i] != rhs.limbs[i])
+                return limbs[i] < rhs.limbs[i];
+        }
+        return false;
+    }
+
+    bool operator<=(const fixed_point& rhs) const { return !(rhs < *this); }
+    bool operator>(const fixed_point& rhs) const { return rhs < *this; }
+    bool operator>=(const fixed_point& rhs) const { return !(*this < rhs); }
+
+    // Casts
+    explicit operator double() const
+    {
+        fixed_point magnitude = abs();
+        double result = 0.0;
+        for (int i = 0; i < LIMBS; ++i)
+            result += ldexp((double)magnitude.limbs[i], 64 * (i - (LIMBS - 1)));
+        return is_negative() ? -result : result;
+    }
+
+    explicit operator float() const { return (float)(double)*this; }
+
+    /// @brief Writes the exact decimal expansion of the fraction, which takes
+    /// about 0.3 digits per fraction bit
+    void serialize(char* buffer) const
+    {
+        fixed_point magnitude = abs();
+        char* out = buffer;
+        if (is_negative())
+            *out++ = '-';
+
+        out += sprintf(out, "%llu.", (unsigned long long)magnitude.limbs[LIMBS - 1]);
+        magnitude.limbs[LIMBS - 1] = 0;
+
+        for (int i = 0; i < DECIMAL_DIGITS; ++i) {
+            magnitude.multiply_small(10);
+            *out++ = '0' + (char)magnitude.limbs[LIMBS - 1];
+            magnitude.limbs[LIMBS - 1] = 0;
+        }
+        *out = '\0';
+    }
+
+    /// @brief Parses a decimal number such as "-0.743643887037158704752191506114774" or
+    /// "1.5e-3". Digits are accumulated in fixed point, so none are lost to double
+    void deserialize(const char* data)
+    {
+        while (isspace(*data))
+            ++data;
+
+        bool negative = *data == '-';
+        if (*data == '-' || *data == '+')
+            ++data;
+
+        fixed_point result;
+        for (; isdigit(*data); ++data) {
+            result.multiply_small(10);
+            result.limbs[LIMBS - 1] += *data - '0';
+        }
+
+        if (*data == '.') {
+            const char* first = ++data;
+            while (isdigit(*data))
+                ++data;
+
+            // From the last digit to the first, fraction = (digit + fraction) / 10
+            fixed_point fraction;
+            for (const char* c = data; c-- != first;) {
+                fraction.limbs[LIMBS - 1] += *c - '0';
+                fraction.divide_small(10);
+            }
+            result = result + fraction;
+        }
+
+        if (*data == 'e' || *data == 'E') {
+            long long exponent = atoll(data + 1);
+            for (; exponent > 0; --exponent)
+                result.multiply_small(10);
+            for (; exponent < 0; ++exponent)
+                result.divide_small(10);
+        }
+
+        *this = negative ? -result : result;
+    }
+
+private:
+    /// @brief Enough for the fraction to round trip through serialize()
+    static constexpr int DECIMAL_DIGITS = 64 * (LIMBS - 1) * 30103 / 100000 + 2;
+
+    bool is_negative() const { return (int64_t)limbs[LIMBS - 1] < 0; }
+
+    static inline unsigned char add_carry(unsigned char carry, uint64_t a, uint64_t b, uint64_t& out)
+    {
+#ifdef __x86_64__
+        return _addcarry_u64(carry, a, b, (unsigned long long*)&out);
+#else
+        unsigned __int128 sum = (unsigned __int128)a + b + carry;
+        out = (uint64_t)sum;
+        return (unsigned char)(sum >> 64);
+#endif
+    }
+
+    static inline unsigned char sub_borrow(unsigned char borrow, uint64_t a, uint64_t b, uint64_t& out)
+    {
+#ifdef __x86_64__
+        return _subborrow_u64(borrow, a, b, (unsigned long long*)&out);
+#else
+        out = a - b - borrow;
+        return (unsigned char)((unsigned __int128)a < (unsigned __int128)b + borrow);
+#endif
+    }
+
+    fixed_point abs() const { return is_negative() ? -*this : *this; }
+
+    /// @brief Saturates past the integer range, which only happens when the value
+    /// already escaped
+    void from_double(double d)
+    {
+        bool negative = d < 0.0;
+        d = fabs(d);
+        if (!(d < 9.2e18))
+            d = isnan(d) ? 0.0 : 9.2e18;
+
+        limbs[LIMBS - 1] = (uint64_t)d;
+        double fraction = d - (double)limbs[LIMBS - 1];
+        for (int i = LIMBS - 2; i >= 0; --i) {
+            fraction = ldexp(fraction, 64);
+            limbs[i] = (uint64_t)fraction;
+            fraction -= (double)limbs[i];
+        }
+
+        if (negative)
+            *this = -*this;
+    }
+
+    // Helpers on magnitudes
+
+    void multiply_small(uint64_t factor)
+    {
+        unsigned __int128 carry = 0;
+        for (int i = 0; i < LIMBS; ++i) {
+            carry += (unsigned __int128)limbs[i] * factor;
+            limbs[i] = (uint64_t)carry;
+            carry >>= 64;
+        }
+    }
+
+    void divide_small(uint64_t divisor)
+    {
+        unsigned __int128 remainder = 0;
+        for (int i = LIMBS - 1; i >= 0; --i) {
+            unsigned __int128 current = (remainder << 64) | limbs[i];
+            limbs[i] = (uint64_t)(current / divisor);
+            remainder = current % divisor;
+        }
+    }
+
+    /// @brief Shifts left for positive bits and right for negative ones
+    void shift(int64_t bits)
+    {
+        uint64_t result[LIMBS] = {};
+        int64_t limb_shift = bits >= 0 ? bits / 64 : -((-bits + 63) / 64);
+        int bit_shift = (int)(bits - limb_shift * 64);
+
+        for (int i = 0; i < LIMBS; ++i) {
+            int64_t src = i - limb_shift;
+            uint64_t high = src >= 0 && src < LIMBS ? limbs[src] : 0;
+            uint64_t low = src - 1 >= 0 && src - 1 < LIMBS ? limbs[src - 1] : 0;
+            result[i] = bit_shift ? (high << bit_shift) | (low >> (64 - bit_shift)) : high;
+        }
+
+        for (int i = 0; i < LIMBS; ++i)
+            limbs[i] = result[i];
+    }
+};
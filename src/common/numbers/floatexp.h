@@ -0,0 +1,160 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "decimal.h"
+
+/// @brief Double mantissa with a separate 64 bit exponent, representing
+/// mantissa * 2^exponent. It has the precision of double with an effectively
+/// unbounded range, so values past 1e-308 don't underflow
+class floatexp {
+public:
+    /// @brief 1 <= |mantissa| < 2, or 0
+    double mantissa;
+    int64_t exponent;
+
+    floatexp()
+        : mantissa(0.0)
+        , exponent(ZERO_EXPONENT)
+    {
+    }
+
+    floatexp(double d)
+        : mantissa(d)
+        , exponent(0)
+    {
+        normalize();
+    }
+
+    floatexp(double m, int64_t e)
+        : mantissa(m)
+        , exponent(e)
+    {
+        normalize();
+    }
+
+    floatexp operator-() const { return from_normalized(-mantissa, exponent); }
+
+    floatexp operator+(const floatexp& rhs) const
+    {
+        const floatexp& big = exponent >= rhs.exponent ? *this : rhs;
+        const floatexp& small = exponent >= rhs.exponent ? rhs : *this;
+
+        // The smaller term is below the rounding of the bigger one. This also
+        // covers zero, whose exponent is far below any other
+        int64_t shift = big.exponent - small.exponent;
+        if (shift > 64)
+            return big;
+
+        return from_unnormalized(big.mantissa + small.mantissa * exp2_negative(shift), big.exponent);
+    }
+
+    floatexp operator-(const floatexp& rhs) const { return *this + (-rhs); }
+
+    floatexp operator*(const floatexp& rhs) const
+    {
+        return from_unnormalized(mantissa * rhs.mantissa, exponent + rhs.exponent);
+    }
+
+    floatexp operator/(const floatexp& rhs) const
+    {
+        return from_unnormalized(mantissa / rhs.mantissa, exponent - rhs.exponent);
+    }
+
+    floatexp& operator+=(const floatexp& rhs) { return *this = *this + rhs; }
+    floatexp& operator-=(const floatexp& rhs) { return *this = *this - rhs; }
+    floatexp& operator*=(const floatexp& rhs) { return *this = *this * rhs; }
+    floatexp& operator/=(const floatexp& rhs) { return *this = *this / rhs; }
+
+    // Math operations
+    floatexp log() const { return ::log(mantissa) + (double)exponent * M_LN2; }
+    floatexp log2() const { return ::log2(mantissa) + (double)exponent; }
+
+    // Comparison operators. Normalization makes the representation unique
+    bool operator==(const floatexp& rhs) const { return mantissa == rhs.mantissa && exponent == rhs.exponent; }
+    bool operator!=(const floatexp& rhs) const { return !(*this == rhs); }
+    bool operator<(const floatexp& rhs) const { return (*this - rhs).mantissa < 0.0; }
+    bool operator<=(const floatexp& rhs) const { return !(rhs < *this); }
+    bool operator>(const floatexp& rhs) const { return rhs < *this; }
+    bool operator>=(const floatexp& rhs) const { return !(*this < rhs); }
+
+    // Casts. Exponents out of the range of double saturate to infinity or zero
+    explicit operator double() const
+    {
+        int64_t e = exponent < -2000 ? -2000 : exponent > 2000 ? 2000 : exponent;
+        return ldexp(mantissa, (int)e);
+    }
+    explicit operator float() const { return (float)(double)*this; }
+
+    void serialize(char* buffer) const
+    {
+        decimal::to_string(*this, 17, buffer, NUMBER_SERIAL_SIZE);
+    }
+
+    void deserialize(const char* data)
+    {
+        decimal::from_string(data, *this);
+    }
+
+private:
+    /// @brief Far enough below any reachable exponent for additions to skip zero,
+    /// and far enough from INT64_MIN for exponent sums not to overflow
+    static constexpr int64_t ZERO_EXPONENT = INT64_MIN / 4;
+
+    static floatexp from_normalized(double m, int64_t e)
+    {
+        floatexp result;
+        result.mantissa = m;
+        result.exponent = e;
+        return result;
+    }
+
+    /// @brief Normalization is only needed when the mantissa left [1, 2), which
+    /// is usually a single bit of carry for products and sums
+    static floatexp from_unnormalized(double m, int64_t e)
+    {
+        floatexp result = from_normalized(m, e);
+        double magnitude = fabs(m);
+        if (!(magnitude >= 1.0 && magnitude < 2.0))
+            result.normalize();
+        return result;
+    }
+
+    /// @brief 2^-shift for shift in [0, 64], built from its bits
+    static double exp2_negative(int64_t shift)
+    {
+        uint64_t bits = (uint64_t)(1023 - shift) << 52;
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    /// @brief Moves the exponent bits of the mantissa into the exponent
+    void normalize()
+    {
+        uint64_t bits;
+        memcpy(&bits, &mantissa, sizeof(bits));
+        int64_t biased_exponent = (bits >> 52) & 0x7ff;
+
+        // Infinity and NaN are kept as they are
+        if (biased_exponent == 0x7ff)
+            return;
+
+        if (biased_exponent == 0) {
+            if (mantissa == 0.0) {
+                exponent = ZERO_EXPONENT;
+                return;
+            }
+
+            // Subnormal, frexp() returns a mantissa in [0.5, 1)
+            int e;
+            mantissa = frexp(mantissa, &e) * 2.0;
+            exponent += e - 1;
+            return;
+        }
+
+        exponent += biased_exponent - 1023;
+        bits = (bits & ~(0x7ffULL << 52)) | (1023ULL << 52);
+        memcpy(&mantissa, &bits, sizeof(mantissa));
+    }
+};
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+#include <math.h>
+#include "../simd.h"
+
+// Error free transformations shared by the double-double and quad-double types.
+// They are templated on the component type D, which is either double or a GCC
+// vector of doubles. All of them are branch free, so the fractal kernels iterate
+// these numbers with vector instructions just like plain doubles.
+// Based on the algorithms of the QD library by Hida, Li and Bailey
+
+namespace multi_double {
+
+// Results are written through references instead of returned, since returning wide
+// vectors from functions compiled without AVX changes the ABI. They are always
+// inlined, so the kernels compile them with their own instruction set. Every input
+// is read before the outputs are written, so outputs can alias inputs
+
+/// @brief a + b = s + err exactly, requires |a| >= |b|
+template <typename D>
+SIMD_INLINE void quick_two_sum(const D& a, const D& b, D& s, D& err)
+{
+    D sum = a + b;
+    D e = b - (sum - a);
+    s = sum;
+    err = e;
+}
+
+/// @brief a + b = s + err exactly
+template <typename D>
+SIMD_INLINE void two_sum(const D& a, const D& b, D& s, D& err)
+{
+    D sum = a + b;
+    D bb = sum - a;
+    D e = (a - (sum - bb)) + (b - bb);
+    s = sum;
+    err = e;
+}
+
+/// @brief a * b = p + err exactly, with Dekker's product. Each factor is split into
+/// two 26 bit halves, so it relies on products not being contracted into FMA
+template <typename D>
+SIMD_INLINE void two_prod(const D& a, const D& b, D& p, D& err)
+{
+    const double splitter = 134217729.0; // 2^27 + 1
+    D product = a * b;
+    D ta = splitter * a;
+    D a_hi = ta - (ta - a);
+    D a_lo = a - a_hi;
+    D tb = splitter * b;
+    D b_hi = tb - (tb - b);
+    D b_lo = b - b_hi;
+    D e = ((a_hi * b_hi - product) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+    p = product;
+    err = e;
+}
+
+#ifdef __FMA__
+/// @brief Scalar version using the hardware FMA, which gives the same exact result
+SIMD_INLINE void two_prod(const double& a, const double& b, double& p, double& err)
+{
+    double product = a * b;
+    double e = fma(a, b, -product);
+    p = product;
+    err = e;
+}
+#endif
+
+/// @brief Sums a, b and c, leaving the result in a and the errors in b and c
+template <typename D>
+SIMD_INLINE void three_sum(D& a, D& b, D& c)
+{
+    D t1, t2, t3;
+    two_sum(a, b, t1, t2);
+    two_sum(c, t1, a, t3);
+    two_sum(t2, t3, b, c);
+}
+
+/// @brief Same as three_sum(), but the lowest error term is added into b
+template <typename D>
+SIMD_INLINE void three_sum2(D& a, D& b, D& c)
+{
+    D t1, t2, t3;
+    two_sum(a, b, t1, t2);
+    two_sum(c, t1, a, t3);
+    b = t2 + t3;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,232 @@
+#pragma once
+#include "multi_double.h"
+#include "decimal.h"
+#include "../simd.h"
+
+/// @brief Unevaluated sum of four doubles, giving about 212 bits of mantissa
+/// with the exponent range of double. D is double, or a vector of doubles when
+/// the number is iterated by the SIMD kernels
+template <typename D>
+class basic_quad_double {
+public:
+    D x[4];
+
+    basic_quad_double()
+        : x {}
+    {
+    }
+
+    basic_quad_double(double d)
+        : x { d, D(), D(), D() }
+    {
+    }
+
+    basic_quad_double(const D& x0, const D& x1, const D& x2, const D& x3)
+        : x { x0, x1, x2, x3 }
+    {
+    }
+
+    SIMD_INLINE basic_quad_double operator-() const { return basic_quad_double(-x[0], -x[1], -x[2], -x[3]); }
+
+    SIMD_INLINE basic_quad_double operator+(const basic_quad_double& rhs) const
+    {
+        D s0, s1, s2, s3;
+        D t0, t1, t2, t3;
+
+        multi_double::two_sum(x[0], rhs.x[0], s0, t0);
+        multi_double::two_sum(x[1], rhs.x[1], s1, t1);
+        multi_double::two_sum(x[2], rhs.x[2], s2, t2);
+        multi_double::two_sum(x[3], rhs.x[3], s3, t3);
+
+        multi_double::two_sum(s1, t0, s1, t0);
+        multi_double::three_sum(s2, t0, t1);
+        multi_double::three_sum2(s3, t0, t2);
+        t0 = t0 + t1 + t3;
+
+        return renormalize(s0, s1, s2, s3, t0);
+    }
+
+    SIMD_INLINE basic_quad_double operator-(const basic_quad_double& rhs) const
+    {
+        return *this + (-rhs);
+    }
+
+    SIMD_INLINE basic_quad_double operator*(const basic_quad_double& rhs) const
+    {
+        const D* a = x;
+        const D* b = rhs.x;
+        D p0, p1, p2, p3, p4, p5;
+        D q0, q1, q2, q3, q4, q5;
+        D s0, s1, s2;
+        D t0, t1;
+
+        // Exact products of order eps^0, eps^1 and eps^2
+        multi_double::two_prod(a[0], b[0], p0, q0);
+        multi_double::two_prod(a[0], b[1], p1, q1);
+        multi_double::two_prod(a[1], b[0], p2, q2);
+        multi_double::two_prod(a[0], b[2], p3, q3);
+        multi_double::two_prod(a[1], b[1], p4, q4);
+        multi_double::two_prod(a[2], b[0], p5, q5);
+
+        multi_double::three_sum(p1, p2, q0);
+
+        // Sums the six eps^2 terms p2, q1, q2, p3, p4, p5 into s0, s1, s2
+        multi_double::three_sum(p2, q1, q2);
+        multi_double::three_sum(p3, p4, p5);
+
+        multi_double::two_sum(p2, p3, s0, t0);
+        multi_double::two_sum(q1, p4, s1, t1);
+        s2 = q2 + p5;
+        multi_double::two_sum(s1, t0, s1, t0);
+        s2 += (t0 + t1);
+
+        // Terms of order eps^3 only need ordinary arithmetic
+        s1 += a[0] * b[3] + a[1] * b[2] + a[2] * b[1] + a[3] * b[0] + q0 + q3 + q4 + q5;
+
+        return renormalize(p0, p1, s0, s1, s2);
+    }
+
+    basic_quad_double operator/(const basic_quad_double& rhs) const
+    {
+        // Long division, one double of quotient at a time
+        D q0 = x[0] / rhs.x[0];
+        basic_quad_double r = *this - rhs * basic_quad_double(q0, D(), D(), D());
+
+        D q1 = r.x[0] / rhs.x[0];
+        r = r - rhs * basic_quad_double(q1, D(), D(), D());
+
+        D q2 = r.x[0] / rhs.x[0];
+        r = r - rhs * basic_quad_double(q2, D(), D(), D());
+
+        D q3 = r.x[0] / rhs.x[0];
+        r = r - rhs * basic_quad_double(q3, D(), D(), D());
+
+        D q4 = r.x[0] / rhs.x[0];
+
+        return renormalize(q0, q1, q2, q3, q4);
+    }
+
+    basic_quad_double& operator+=(const basic_quad_double& rhs) { return *this = *this + rhs; }
+    basic_quad_double& operator-=(const basic_quad_double& rhs) { return *this = *this - rhs; }
+    basic_quad_double& operator*=(const basic_quad_double& rhs) { return *this = *this * rhs; }
+    basic_quad_double& operator/=(const basic_quad_double& rhs) { return *this = *this / rhs; }
+
+    // Logarithms are only used to smooth the escape count, so one correction
+    // term over the double logarithm is precise enough
+    basic_quad_double log() const { return ::log(x[0]) + x[1] / x[0]; }
+    basic_quad_double log2() const { return ::log2(x[0]) + x[1] / (x[0] * M_LN2); }
+
+    // Comparison operators
+    bool operator==(const basic_quad_double& rhs) const
+    {
+        return x[0] == rhs.x[0] && x[1] == rhs.x[1] && x[2] == rhs.x[2] && x[3] == rhs.x[3];
+    }
+    bool operator!=(const basic_quad_double& rhs) const { return !(*this == rhs); }
+    bool operator<(const basic_quad_double& rhs) const
+    {
+        for (int i = 0; i < 3; ++i) {
+            if (x[i] != rhs.x[i])
+                return x[i] < rhs.x[i];
+        }
+        return x[3] < rhs.x[3];
+    }
+    bool operator<=(const basic_quad_double& rhs) const { return !(rhs < *this); }
+    bool operator>(const basic_quad_double& rhs) const { return rhs < *this; }
+    bool operator>=(const basic_quad_double& rhs) const { return !(*this < rhs); }
+
+    // Casts
+    explicit operator double() const { return x[0] + x[1]; }
+    explicit operator float() const { return (float)(x[0] + x[1]); }
+
+    void serialize(char* buffer) const
+    {
+        decimal::to_string(*this, 66, buffer, NUMBER_SERIAL_SIZE);
+    }
+
+    void deserialize(const char* data)
+    {
+        decimal::from_string(data, *this);
+    }
+
+private:
+    /// @brief Turns five overlapping terms into four non overlapping components.
+    /// Unlike the QD library, zero components aren't special cased, so there are no branches
+    static SIMD_INLINE basic_quad_double renormalize(const D& c0, const D& c1, const D& c2, const D& c3, const D& c4)
+    {
+        D r0, r1, r2, r3;
+        D s, e1, e2, e3, e4;
+
+        // Bottom up, accumulates the sum into c0
+        multi_double::quick_two_sum(c3, c4, s, e4);
+        multi_double::quick_two_sum(c2, s, s, e3);
+        multi_double::quick_two_sum(c1, s, s, e2);
+        multi_double::quick_two_sum(c0, s, r0, e1);
+
+        // Top down, the errors can be in any order
+        D t1, t2;
+        multi_double::two_sum(e1, e2, r1, t1);
+        multi_double::two_sum(t1, e3, r2, t2);
+        r3 = t2 + e4;
+
+        return basic_quad_double(r0, r1, r2, r3);
+    }
+};
+
+typedef basic_quad_double<double> quad_double;
+
+/// @brief Lanes of quad-double numbers, stored as a vector per component
+template <int N>
+struct SimdLanes<quad_double, N> {
+    typedef typename SimdLanes<double, N>::vec component;
+    typedef basic_quad_double<component> vec;
+    typedef typename SimdLanes<double, N>::mask mask;
+    typedef component wide;
+
+    // Each lane group already spans four registers, so a single group keeps
+    // enough independent work in flight without spilling
+    static constexpr int unroll = 1;
+
+    static SIMD_INLINE void load(vec& dst, const quad_double* src)
+    {
+        for (int c = 0; c < 4; ++c) {
+            for (int k = 0; k < N; ++k)
+                dst.x[c][k] = src[k].x[c];
+        }
+    }
+
+    static SIMD_INLINE void broadcast(vec& dst, const quad_double& value)
+    {
+        for (int c = 0; c < 4; ++c)
+            dst.x[c] = component {} + value.x[c];
+    }
+
+    /// @brief Lexicographic comparison of the components, without branches
+    static SIMD_INLINE void less(mask& dst, const vec& a, const vec& b)
+    {
+        dst = a.x[3] < b.x[3];
+        for (int c = 2; c >= 0; --c)
+            dst = (a.x[c] < b.x[c]) | ((a.x[c] == b.x[c]) & dst);
+    }
+
+    static SIMD_INLINE void blend(vec& dst, const mask& m, const vec& src)
+    {
+        for (int c = 0; c < 4; ++c)
+            dst.x[c] = m ? src.x[c] : dst.x[c];
+    }
+
+    static SIMD_INLINE quad_double lane(const vec& v, int k)
+    {
+        return quad_double(v.x[0][k], v.x[1][k], v.x[2][k], v.x[3][k]);
+    }
+
+    /// @brief Leading component of each lane
+    static SIMD_INLINE void to_wide(wide& dst, const vec& v) { dst = v.x[0]; }
+    static SIMD_INLINE void blend_wide(wide& dst, const mask& m, const wide& src) { dst = m ? src : dst; }
+};
+
+/// @brief Each lane holds four doubles, so a register fits as many lanes as with double
+template <>
+constexpr int simd_lanes<quad_double>(SimdLevel level)
+{
+    return simd_lanes<double>(level);
+}
\ No newline at end of file
@@ -17,7 +17,9 @@ std::shared_ptr<OutputHandler> OutputHandler::factory_create(OutputSettingsMode
     case OutputSettingsMode::NETWORK:
         return std::make_shared<NetworkOutputHandler>();
 
+    // Fields aren't images, see FieldFile
     case OutputSettingsMode::DISABLED:
+    case OutputSettingsMode::FIELD:
         return std::make_shared<OutputHandler>();
 
     default:
@@ -0,0 +1,108 @@
+#include "palette.h"
+#include "color_mode.h"
+#include "common/logging.h"
+#include <cstdio>
+
+static bool is_stop_before(const GradientStop& a, const GradientStop& b)
+{
+    return a.position < b.position;
+}
+
+/// @brief Color of the gradient at position, interpolated between the stops around it
+static void sample_gradient(const GradientSettings& gradient, float position, float& r, float& g, float& b)
+{
+    const GradientStop* stops = gradient.stops;
+    uint32_t next = 0;
+    while (next < gradient.stop_count && stops[next].position <= position)
+        next++;
+
+    // Positions outside the stops take the color of the closest one
+    const GradientStop& before = stops[next > 0 ? next - 1 : 0];
+    const GradientStop& after = stops[next < gradient.stop_count ? next : gradient.stop_count - 1];
+    float length = after.position - before.position;
+    float fraction = length > 0.0f ? (position - before.position) / length : 0.0f;
+
+    r = before.r + fraction * (after.r - before.r);
+    g = before.g + fraction * (after.g - before.g);
+    b = before.b + fraction * (after.b - before.b);
+}
+
+Palette::Palette(const FractalSettings& fractal_settings)
+    : red(PALETTE_SIZE + 1)
+    , green(PALETTE_SIZE + 1)
+    , blue(PALETTE_SIZE + 1)
+{
+    const GradientSettings& gradient = fractal_settings.gradient;
+
+    if (gradient.stop_count > 0) {
+        for (uint32_t k = 0; k < PALETTE_SIZE; ++k)
+            sample_gradient(gradient, (float)k / PALETTE_SIZE, red[k], green[k], blue[k]);
+
+        inside_red = inside_green = inside_blue = 0.0f;
+    } else {
+        ColorFunction* color_function = get_color_function(fractal_settings.color_mode);
+        for (uint32_t k = 0; k < PALETTE_SIZE; ++k)
+            color_function((float)k / PALETTE_SIZE, red[k], green[k], blue[k]);
+
+        color_function(1.0f, inside_red, inside_green, inside_blue);
+    }
+
+    red[PALETTE_SIZE] = red[PALETTE_SIZE - 1];
+    green[PALETTE_SIZE] = green[PALETTE_SIZE - 1];
+    blue[PALETTE_SIZE] = blue[PALETTE_SIZE - 1];
+}
+
+void Palette::color(const float* t, float* r, float* g, float* b, uint32_t count) const
+{
+    const float* red_table = red.data();
+    const float* green_table = green.data();
+    const float* blue_table = blue.data();
+
+    for (uint32_t k = 0; k < count; ++k) {
+        float value = t[k] > 0.0f ? t[k] : 0.0f;
+        bool inside = value >= 1.0f;
+
+        // Inside values are looked up at the last entry, and replaced
+        float position = std::min(value, 1.0f) * PALETTE_SIZE;
+        uint32_t index = std::min((uint32_t)position, (uint32_t)PALETTE_SIZE - 1);
+        float fraction = position - index;
+
+        float lookup_r = red_table[index] + fraction * (red_table[index + 1] - red_table[index]);
+        float lookup_g = green_table[index] + fraction * (green_table[index + 1] - green_table[index]);
+        float lookup_b = blue_table[index] + fraction * (blue_table[index + 1] - blue_table[index]);
+
+        r[k] = inside ? inside_red : lookup_r;
+        g[k] = inside ? inside_green : lookup_g;
+        b[k] = inside ? inside_blue : lookup_b;
+    }
+}
+
+bool load_gradient(const char* path, GradientSettings& gradient)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    gradient.stop_count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        float position, r, g, b;
+        if (line[0] == '#' || sscanf(line, "%f %f %f %f", &position, &r, &g, &b) != 4)
+            continue;
+
+        if (gradient.stop_count == GRADIENT_MAX_STOPS) {
+            LOG_WARNING("Gradient \"" << path << "\" has more than " << GRADIENT_MAX_STOPS << " stops. Ignoring the rest");
+            break;
+        }
+
+        GradientStop& stop = gradient.stops[gradient.stop_count++];
+        stop.position = std::min(std::max(position, 0.0f), 1.0f);
+        stop.r = std::min(std::max(r / 255.0f, 0.0f), 1.0f);
+        stop.g = std::min(std::max(g / 255.0f, 0.0f), 1.0f);
+        stop.b = std::min(std::max(b / 255.0f, 0.0f), 1.0f);
+    }
+    fclose(file);
+
+    std::stable_sort(gradient.stops, gradient.stops + gradient.stop_count, is_stop_before);
+    return gradient.stop_count > 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include "settings/fractal_settings.h"
+
+/// @brief Entries of the lookup table of a palette over [0, 1). The cyclic color modes
+/// repeat up to ~190 times over the range, which still leaves ~86 entries per period
+#ifndef PALETTE_SIZE
+#define PALETTE_SIZE 16384
+#endif
+
+/// @brief Colors of the sampled values, compiled once per render from a ColorMode or a user
+/// gradient into a lookup table that's linearly interpolated. Values of 1 are inside the
+/// set and take the color of the mode at 1, or black with a gradient
+class Palette {
+public:
+    Palette(const FractalSettings& fractal_settings);
+
+    void color(float t, float& r, float& g, float& b) const
+    {
+        // NaN is colored as 0
+        float value = t > 0.0f ? t : 0.0f;
+        if (value >= 1.0f) {
+            r = inside_red;
+            g = inside_green;
+            b = inside_blue;
+            return;
+        }
+
+        float position = value * PALETTE_SIZE;
+        uint32_t index = (uint32_t)position;
+        float fraction = position - index;
+        r = red[index] + fraction * (red[index + 1] - red[index]);
+        g = green[index] + fraction * (green[index + 1] - green[index]);
+        b = blue[index] + fraction * (blue[index + 1] - blue[index]);
+    }
+
+    /// @brief Colors count values into separate channels, which lets a row of samples
+    /// be looked up in a loop that vectorizes
+    void color(const float* t, float* r, float* g, float* b, uint32_t count) const;
+
+private:
+    // PALETTE_SIZE + 1 entries, the last one repeats the color before 1 for the interpolation
+    std::vector<float> red, green, blue;
+    float inside_red, inside_green, inside_blue;
+};
+
+/// @brief Reads the color stops of a gradient file. Each line holds a position in [0, 1]
+/// followed by the red, green and blue components in [0, 255]. Empty lines and lines
+/// starting with '#' are skipped. Returns false when the file can't be read or has no stops
+bool load_gradient(const char* path, GradientSettings& gradient);
@@ -0,0 +1,155 @@
+#include "perturbation.h"
+#include <math.h>
+
+void compute_reference_orbit(
+    const Camera& camera,
+    const FractalSettings& settings,
+    ReferenceOrbit& orbit)
+{
+    const number two(2.0);
+    const number escape_radius_squared(4.0);
+
+    number zx = 0.0;
+    number zy = 0.0;
+    number zx2 = 0.0;
+    number zy2 = 0.0;
+
+    orbit.x.clear();
+    orbit.y.clear();
+    orbit.x.reserve(settings.max_iterations + 1);
+    orbit.y.reserve(settings.max_iterations + 1);
+
+    orbit.x.push_back(0.0);
+    orbit.y.push_back(0.0);
+
+    for (int iter = 0; iter < settings.max_iterations; ++iter) {
+        zy = two * zx * zy + camera.y;
+        zx = zx2 - zy2 + camera.x;
+
+        zx2 = zx * zx;
+        zy2 = zy * zy;
+
+        orbit.x.push_back((double)zx);
+        orbit.y.push_back((double)zy);
+
+        if (zx2 + zy2 >= escape_radius_squared)
+            break;
+    }
+}
+
+floatexp perturbation_delta_scale(const Camera& camera)
+{
+#ifdef NUMBER_HAS_ZOOM_TYPE
+    // The zoom already has an extended exponent
+    return floatexp(1.0) / camera.zoom;
+#else
+    number scale = number(1.0) / camera.zoom;
+
+#ifdef USE_MPFR
+    // Exact, with the exponent kept apart from the double mantissa
+    long exponent;
+    double mantissa = mpfr_get_d_2exp(&exponent, scale.n_ptr, MPFR_RNDN);
+    return floatexp(mantissa, exponent);
+#elif PRECISION_128
+    int exponent;
+    long double mantissa = frexpl(scale, &exponent);
+    return floatexp((double)mantissa, exponent);
+#elif PRECISION_FLOATEXP
+    return scale;
+#else
+    return floatexp((double)scale);
+#endif
+#endif
+}
+
+/// @brief Iterates the delta dz(n) = z(n) - Z(n), where
+/// dz(n + 1) = 2 * Z(n) * dz(n) + dz(n)^2 + dc. Delta is double, or floatexp
+/// when the offsets are beyond the range of double. Full z is always near the
+/// reference orbit, so it's computed in double either way
+template <typename Delta>
+static float mandelbrot_perturbation_sampler(
+    const Delta& dcx,
+    const Delta& dcy,
+    const ReferenceOrbit& orbit,
+    const FractalSettings& settings)
+{
+    const double* ref_x = orbit.x.data();
+    const double* ref_y = orbit.y.data();
+    const uint32_t last = orbit.length() - 1;
+
+    Delta dzx = 0.0;
+    Delta dzy = 0.0;
+    double length_squared = 0.0;
+    uint32_t ref_iter = 0;
+    uint32_t iter = 0;
+
+    while (iter < (uint32_t)settings.max_iterations) {
+
+        // (2 * Z + dz) * dz + dc
+        Delta ax = Delta(2.0 * ref_x[ref_iter]) + dzx;
+        Delta ay = Delta(2.0 * ref_y[ref_iter]) + dzy;
+        Delta next_dzx = ax * dzx - ay * dzy + dcx;
+        Delta next_dzy = ax * dzy + ay * dzx + dcy;
+        dzx = next_dzx;
+        dzy = next_dzy;
+
+        ++ref_iter;
+        ++iter;
+
+        double dx = (double)dzx;
+        double dy = (double)dzy;
+        double zx = ref_x[ref_iter] + dx;
+        double zy = ref_y[ref_iter] + dy;
+        length_squared = zx * zx + zy * zy;
+
+        if (length_squared >= 4.0)
+            break;
+
+        // Glitch detection: once the full orbit gets closer to zero than the delta,
+        // the delta no longer holds the significant digits of z. Rebasing restarts
+        // the delta against Z(0) = 0, which keeps it exact. The same happens when
+        // the reference escaped before the pixel, since there are no more Z(n)
+        if (length_squared < dx * dx + dy * dy || ref_iter == last) {
+            dzx = zx;
+            dzy = zy;
+            ref_iter = 0;
+        }
+    }
+
+    // Same smoothing as mandelbrot_sampler()
+    if (iter >= settings.max_iterations)
+        return 1.0f;
+
+    double smooth_t = (double)iter;
+    if (length_squared > 0.0) {
+        double log_zn = log(length_squared) / 2.0;
+        double nu = log2(log_zn / 0.69314718056);
+        smooth_t = (double)iter - nu;
+    }
+
+    return (float)(smooth_t / (double)settings.max_iterations);
+}
+
+void mandelbrot_perturbation_batch_sampler(
+    const double* dcx,
+    const double* dcy,
+    float* t,
+    uint32_t count,
+    const ReferenceOrbit& orbit,
+    const FractalSettings& settings)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        t[i] = mandelbrot_perturbation_sampler(dcx[i], dcy[i], orbit, settings);
+}
+
+void mandelbrot_perturbation_batch_sampler(
+    const floatexp* dcx,
+    const floatexp* dcy,
+    float* t,
+    uint32_t count,
+    const ReferenceOrbit& orbit,
+    const FractalSettings& settings)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        t[i] = mandelbrot_perturbation_sampler(dcx[i], dcy[i], orbit, settings);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include "settings/camera.h"
+#include "settings/fractal_settings.h"
+#include "numbers/floatexp.h"
+
+/// @brief Delta scale below which pixel offsets are iterated as floatexp. Deltas
+/// close to the smallest double lose their precision as subnormals, so the switch
+/// happens well before it
+#define PERTURBATION_FLOATEXP_SCALE 1e-290
+
+/// @brief Orbit of the camera center, iterated once at full precision. Pixels are
+/// then iterated as low precision deltas relative to this orbit
+struct ReferenceOrbit {
+
+    /// @brief Z(n) of the reference point, rounded to double. Includes Z(0) and,
+    /// if the reference escapes, the first point outside the escape radius
+    std::vector<double> x, y;
+
+    uint32_t length() const { return x.size(); }
+};
+
+/// @brief Iterates the camera center with the full precision number type
+void compute_reference_orbit(
+    const Camera& camera,
+    const FractalSettings& settings,
+    ReferenceOrbit& orbit);
+
+/// @brief World size of one unit of normalized screen coordinates, that is 1 / zoom.
+/// Returned as floatexp, since deep zooms go past the range of double
+floatexp perturbation_delta_scale(const Camera& camera);
+
+/// @brief Samples count points given by their offset (dcx, dcy) from the reference point
+void mandelbrot_perturbation_batch_sampler(
+    const double* dcx,
+    const double* dcy,
+    float* t,
+    uint32_t count,
+    const ReferenceOrbit& orbit,
+    const FractalSettings& settings);
+
+/// @brief Same as above, for offsets below PERTURBATION_FLOATEXP_SCALE
+void mandelbrot_perturbation_batch_sampler(
+    const floatexp* dcx,
+    const floatexp* dcy,
+    float* t,
+    uint32_t count,
+    const ReferenceOrbit& orbit,
+    const FractalSettings& settings);
\ No newline at end of file
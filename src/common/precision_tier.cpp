@@ -0,0 +1,103 @@
+#include "precision_tier.h"
+#include "settings/image_settings.h"
+#include "settings/fractal_settings.h"
+#include "settings/camera.h"
+#include <math.h>
+#include <algorithm>
+
+static uint32_t get_precision_tier_bits(PrecisionTier tier)
+{
+    switch (tier) {
+    case PrecisionTier::FLOAT:
+        return 24;
+    case PrecisionTier::DOUBLE:
+        return 53;
+    case PrecisionTier::EXTENDED:
+        return 106;
+    default:
+        return NUMBER_PRECISION_BITS;
+    }
+}
+
+static bool is_precision_tier_compiled(PrecisionTier tier)
+{
+    switch (tier) {
+#ifdef PRECISION_TIER_FLOAT
+    case PrecisionTier::FLOAT:
+#endif
+#ifdef PRECISION_TIER_DOUBLE
+    case PrecisionTier::DOUBLE:
+#endif
+#ifdef PRECISION_TIER_EXTENDED
+    case PrecisionTier::EXTENDED:
+#endif
+    case PrecisionTier::FULL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char* get_precision_tier_name(PrecisionTier tier)
+{
+    switch (tier) {
+    case PrecisionTier::FLOAT:
+        return "float";
+    case PrecisionTier::DOUBLE:
+        return "double";
+    case PrecisionTier::EXTENDED:
+        return "double-double";
+    default:
+        return "full";
+    }
+}
+
+PrecisionTier next_precision_tier(PrecisionTier tier)
+{
+    while (tier != PrecisionTier::FULL) {
+        tier = (PrecisionTier)((int)tier + 1);
+        if (is_precision_tier_compiled(tier))
+            break;
+    }
+    return tier;
+}
+
+PrecisionTier select_precision_tier(
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height)
+{
+    // Zooms past the range of double give a spacing of zero, which only the full tier resolves
+    double zoom = (double)camera.zoom;
+    uint32_t n_samples = sqrt(std::max(image_settings.multi_sample_anti_aliasing, image_settings.adaptive_samples));
+    double subpixel_spacing = 1.0 / (zoom * image_settings.height * n_samples);
+    if (!(subpixel_spacing > 0.0) || !isfinite(subpixel_spacing))
+        return PrecisionTier::FULL;
+
+    // World bounds of the block, as the renderer computes them
+    double aspect_ratio = (double)image_settings.width / (double)image_settings.height;
+    double left = ((double)x / image_settings.width - 0.5) * aspect_ratio / zoom + (double)camera.x;
+    double right = ((double)(x + width) / image_settings.width - 0.5) * aspect_ratio / zoom + (double)camera.x;
+    double bottom = ((double)(image_settings.height - y - height) / image_settings.height - 0.5) / zoom + (double)camera.y;
+    double top = ((double)(image_settings.height - y) / image_settings.height - 0.5) / zoom + (double)camera.y;
+
+    // Orbits reach the escape radius, so their precision is never finer than at 2
+    double magnitude = std::max({ fabs(left), fabs(right), fabs(bottom), fabs(top), 2.0 });
+    int exponent;
+    frexp(magnitude, &exponent);
+
+    PrecisionTier tier = PrecisionTier::FLOAT;
+    if (!is_precision_tier_compiled(tier) || fractal_settings.max_iterations > PRECISION_TIER_FLOAT_MAX_ITERATIONS)
+        tier = next_precision_tier(tier);
+
+    for (; tier != PrecisionTier::FULL; tier = next_precision_tier(tier)) {
+        double ulp = ldexp(1.0, exponent - (int)get_precision_tier_bits(tier));
+        if (subpixel_spacing >= ldexp(ulp, PRECISION_TIER_GUARD_BITS))
+            break;
+    }
+    return tier;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include "number.h"
+
+struct ImageSettings;
+struct FractalSettings;
+class Camera;
+
+/// @brief Number types a tile can be rendered with when auto precision is enabled,
+/// from the fastest one to the number of the build
+enum class PrecisionTier {
+    FLOAT,
+    DOUBLE,
+    EXTENDED,
+    FULL
+};
+
+// Only the tiers with fewer bits than NUMBER_PRECISION_BITS are compiled, the
+// others wouldn't be faster than number
+#if NUMBER_PRECISION_BITS > 24
+#define PRECISION_TIER_FLOAT 1
+#endif
+
+#if NUMBER_PRECISION_BITS > 53
+#define PRECISION_TIER_DOUBLE 1
+#endif
+
+#if NUMBER_PRECISION_BITS > 106
+#include "numbers/double_double.h"
+#define PRECISION_TIER_EXTENDED 1
+#endif
+
+/// @brief Bits of a subpixel spacing kept below the coordinates' precision, for
+/// the rounding error the iteration amplifies
+#ifndef PRECISION_TIER_GUARD_BITS
+#define PRECISION_TIER_GUARD_BITS 12
+#endif
+
+/// @brief Float is only selected up to this many iterations. The rounding error it
+/// amplifies near the set changes the escape iteration of pixels past it, at any zoom
+#ifndef PRECISION_TIER_FLOAT_MAX_ITERATIONS
+#define PRECISION_TIER_FLOAT_MAX_ITERATIONS 32
+#endif
+
+/// @brief A tier is escalated when more than 1 in PRECISION_TIER_DUPLICATE_RATIO
+/// pairs of neighbouring escaped samples have the same value
+#ifndef PRECISION_TIER_DUPLICATE_RATIO
+#define PRECISION_TIER_DUPLICATE_RATIO 16
+#endif
+
+const char* get_precision_tier_name(PrecisionTier tier);
+
+/// @brief Next tier compiled in this build, FULL after the widest one
+PrecisionTier next_precision_tier(PrecisionTier tier);
+
+/// @brief Lowest tier that resolves the subpixels of the block, from the zoom and
+/// the spacing of the subpixels relative to the ulp of its coordinates
+PrecisionTier select_precision_tier(
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height);
@@ -1,86 +1,1244 @@
 #include "renderer.h"
-#include <random>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <type_traits>
 #include "fractal.h"
-#include "color_mode.h"
+#include "common/logging.h"
 
-void render_block(
+#ifdef USE_MP_ARENA
+#include "mp_arena.h"
+#endif
+
+/// @brief Returns false when the number type of the block left its samples unresolved.
+/// The samples are colored with the palette into the buffer, or when field isn't null,
+/// their values are stored in it instead, as rows of width pixels
+typedef bool(RenderBlockFunction)(
+    uint8_t*,
+    float*,
+    const ImageSettings&,
+    const FractalSettings&,
+    const Camera&,
+    uint32_t,
+    uint32_t,
+    uint32_t,
+    uint32_t,
+    const Palette*,
+    const ReferenceOrbit*);
+
+/// @brief Offset in pixels of a sample of the n x n grid of a pixel. The grid is centered on
+/// the sample of a single sample render, so mirrored pixels sample mirrored points
+static inline double sample_offset(uint32_t sample, uint32_t n_samples)
+{
+    return (sample + 0.5 - 0.5 * n_samples) / n_samples;
+}
+
+/// @brief Normalized coordinate in [-0.5, 0.5] of a sample. The pixel is centered before
+/// the offset is added, so samples mirrored about the center are exact negations
+static inline double normalized_coordinate(uint32_t pixel, double offset, uint32_t size)
+{
+    return ((double)pixel - 0.5 * size + offset) / size;
+}
+
+/// @brief Camera rounded to the number type of a precision tier
+template <typename T>
+struct TierCamera {
+    T x, y;
+    double zoom;
+
+    TierCamera(const Camera& camera)
+        : x(round_number(camera.x))
+        , y(round_number(camera.y))
+        , zoom((double)camera.zoom)
+    {
+    }
+
+    void to_world_x(double screen_normalized_x, T& world_x) const
+    {
+        world_x = screen_normalized_x;
+        world_x /= zoom;
+        world_x += x;
+    }
+
+    void to_world_y(double screen_normalized_y, T& world_y) const
+    {
+        world_y = screen_normalized_y;
+        world_y /= zoom;
+        world_y += y;
+    }
+
+    /// @brief Sum of the two leading doubles of value, which is exact for double-double
+    static T round_number(const number& value)
+    {
+        double high = (double)value;
+        double low = (double)(value - number(high));
+        return T(high) + T(low);
+    }
+};
+
+/// @brief The number of the build uses the camera as is
+template <>
+struct TierCamera<number> {
+    const Camera& camera;
+
+    TierCamera(const Camera& camera)
+        : camera(camera)
+    {
+    }
+
+    void to_world_x(double screen_normalized_x, number& world_x) const { camera.to_world_x(screen_normalized_x, world_x); }
+    void to_world_y(double screen_normalized_y, number& world_y) const { camera.to_world_y(screen_normalized_y, world_y); }
+};
+
+/// @brief Evaluates a span of points with the sampler of TYPE, resolved at compile time
+template <FractalType TYPE, typename T>
+static inline void sample_span(
+    const T* world_x,
+    const T* world_y,
+    float* t,
+    uint32_t count,
+    const FractalSettings& fractal_settings)
+{
+    if (TYPE == FractalType::JULIA)
+        julia_batch_sampler(world_x, world_y, t, count, fractal_settings);
+    else
+        mandelbrot_batch_sampler(world_x, world_y, t, count, fractal_settings);
+}
+
+/// @brief Renders the block with the coordinates in T, and the fractal type and samples
+/// per axis fixed at compile time. When SAMPLES is 0, the samples are read
+/// from the settings. When T is a precision tier below number, neighbouring escaped
+/// samples are compared, and false is returned if too many have the same value
+template <typename T, FractalType TYPE, uint32_t SAMPLES>
+static bool render_block_impl(
     uint8_t* buffer,
+    float* field,
     const ImageSettings& image_settings,
     const FractalSettings& fractal_settings,
     const Camera& camera,
     uint32_t x,
     uint32_t y,
     uint32_t width,
-    uint32_t height)
+    uint32_t height,
+    const Palette* palette,
+    const ReferenceOrbit* reference_orbit)
 {
+    const uint32_t n_samples = SAMPLES ? SAMPLES : (uint32_t)sqrt(image_settings.multi_sample_anti_aliasing);
+    const uint32_t samples_per_pixel = n_samples * n_samples;
 
-    FractalSampler* fractal_sampler = get_fractal_sampler(fractal_settings.type);
-    ColorFunction* color_function = get_color_function(fractal_settings.color_mode);
-
-    double pixel_size_x = 1.0 / image_settings.width;
-    double pixel_size_y = 1.0 / image_settings.height;
     double aspect_ratio = (double)image_settings.width / (double)image_settings.height;
 
-    uint32_t n_samples = sqrt(image_settings.multi_sample_anti_aliasing);
+    // A row span holds every subpixel of a row, ordered by pixel, then by sample x and by sample y
+    uint32_t row_samples = width * samples_per_pixel;
+    std::vector<float> row_t(row_samples);
+    std::vector<float> row_r(row_samples), row_g(row_samples), row_b(row_samples);
+
+    // With perturbation, spans hold offsets from the camera center instead of world
+    // coordinates. Offsets are floatexp when they would underflow double
+    const bool perturbation = TYPE == FractalType::MANDELBROT && reference_orbit != nullptr;
+    std::vector<T> world_x, world_y, sample_world_y;
+    const TierCamera<T> tier_camera(camera);
+    std::vector<double> delta_x, delta_y;
+    std::vector<floatexp> deep_delta_x, deep_delta_y;
+    floatexp delta_scale;
+    bool deep_deltas = false;
+
+    if (perturbation) {
+        delta_scale = perturbation_delta_scale(camera);
+        deep_deltas = delta_scale < floatexp(PERTURBATION_FLOATEXP_SCALE);
+
+        if (deep_deltas) {
+            deep_delta_x.resize(row_samples);
+            deep_delta_y.resize(row_samples);
+        } else {
+            delta_x.resize(row_samples);
+            delta_y.resize(row_samples);
+        }
+    } else {
+        world_x.resize(row_samples);
+        world_y.resize(row_samples);
+        sample_world_y.resize(n_samples);
+    }
+    const double inverse_zoom = (double)delta_scale;
+
+    // Precision tiers below number give up on the block as soon as neighbouring
+    // pixels round to the same coordinates
+    constexpr bool check_resolution = !std::is_same<T, number>::value;
+    std::vector<float> previous_row_t;
+    T previous_world_y = 0.0;
+    uint32_t neighbour_pairs = 0, duplicate_pairs = 0;
+
+    // World X only depends on the column, so it's the same for every row of the block
+    for (uint32_t i = 0; i < width; ++i) {
+
+        // Computes pixel X coordinate [0, width - 1]
+        uint32_t pixel_x = x + i;
+
+        for (uint32_t sx = 0; sx < n_samples; sx++) {
+            // Computes normalized coordinates in range [-0.5, 0.5]
+            double nx = normalized_coordinate(pixel_x, sample_offset(sx, n_samples), image_settings.width) * aspect_ratio;
+            uint32_t first = (i * n_samples + sx) * n_samples;
+
+            if (deep_deltas) {
+                std::fill(deep_delta_x.begin() + first, deep_delta_x.begin() + first + n_samples, floatexp(nx) * delta_scale);
+            } else if (perturbation) {
+                std::fill(delta_x.begin() + first, delta_x.begin() + first + n_samples, nx * inverse_zoom);
+            } else {
+                tier_camera.to_world_x(nx, world_x[first]);
+                std::fill(world_x.begin() + first + 1, world_x.begin() + first + n_samples, world_x[first]);
+            }
+        }
+
+        if (check_resolution && !perturbation && i > 0 && world_x[i * samples_per_pixel] == world_x[(i - 1) * samples_per_pixel])
+            return false;
+    }
 
-    // Computes the color for each subpixel of the partial image
     for (uint32_t j = 0; j < height; ++j) {
         // Computes pixel Y coordinate [0, height - 1]
         uint32_t pixel_y = image_settings.height - 1 - y - j;
 
-        for (uint32_t i = 0; i < width; ++i) {
+        for (uint32_t sy = 0; sy < n_samples; sy++) {
+            double ny = normalized_coordinate(pixel_y, sample_offset(sy, n_samples), image_settings.height);
 
-            // Computes pixel X coordinate [0, width - 1]
-            uint32_t pixel_x = x + i;
+            if (deep_deltas) {
+                for (uint32_t k = sy; k < row_samples; k += n_samples)
+                    deep_delta_y[k] = floatexp(ny) * delta_scale;
+            } else if (perturbation) {
+                for (uint32_t k = sy; k < row_samples; k += n_samples)
+                    delta_y[k] = ny * inverse_zoom;
+            } else {
+                tier_camera.to_world_y(ny, sample_world_y[sy]);
+            }
+        }
+
+        if (check_resolution && !perturbation) {
+            if (j > 0 && sample_world_y[0] == previous_world_y)
+                return false;
+            previous_world_y = sample_world_y[0];
+        }
+
+        if (deep_deltas) {
+            mandelbrot_perturbation_batch_sampler(
+                deep_delta_x.data(),
+                deep_delta_y.data(),
+                row_t.data(),
+                row_samples,
+                *reference_orbit,
+                fractal_settings);
+        } else if (perturbation) {
+            mandelbrot_perturbation_batch_sampler(
+                delta_x.data(),
+                delta_y.data(),
+                row_t.data(),
+                row_samples,
+                *reference_orbit,
+                fractal_settings);
+        } else {
+            for (uint32_t k = 0; k < row_samples; k += n_samples) {
+                for (uint32_t sy = 0; sy < n_samples; sy++)
+                    world_y[k + sy] = sample_world_y[sy];
+            }
+
+            sample_span<TYPE>(world_x.data(), world_y.data(), row_t.data(), row_samples, fractal_settings);
+        }
+
+        // Orbits that lost their precision while iterating may still start from
+        // distinct coordinates, but escape with the same value as their neighbours,
+        // which is unlikely otherwise. Interior samples are left out, since their t is 1.0
+        if (check_resolution) {
+            for (uint32_t k = 0; k < row_samples; ++k) {
+                if (!(row_t[k] > 0.0f && row_t[k] < 1.0f))
+                    continue;
+
+                // The sample at the same position in the next pixel, and in the previous row
+                uint32_t next = k + samples_per_pixel;
+                if (next < row_samples && row_t[next] > 0.0f && row_t[next] < 1.0f) {
+                    neighbour_pairs++;
+                    duplicate_pairs += row_t[k] == row_t[next];
+                }
+                if (j > 0 && previous_row_t[k] > 0.0f && previous_row_t[k] < 1.0f) {
+                    neighbour_pairs++;
+                    duplicate_pairs += row_t[k] == previous_row_t[k];
+                }
+            }
+            previous_row_t = row_t;
+        }
+
+        if (field) {
+            float* field_row = field + (uint64_t)j * row_samples;
+            for (uint32_t k = 0; k < row_samples; ++k)
+                field_row[k] = row_t[k] > 0.0f ? std::min(row_t[k], 1.0f) : 0.0f;
+            continue;
+        }
+
+        // Colors the whole row with a single lookup pass
+        palette->color(row_t.data(), row_r.data(), row_g.data(), row_b.data(), row_samples);
+
+        const float* sample_r = row_r.data();
+        const float* sample_g = row_g.data();
+        const float* sample_b = row_b.data();
+        for (uint32_t i = 0; i < width; ++i) {
 
             float r = 0.0f, g = 0.0f, b = 0.0f;
 
-            // Adds multi sample anti aliasing
+            for (uint32_t s = 0; s < samples_per_pixel; ++s) {
+                r += *sample_r++;
+                g += *sample_g++;
+                b += *sample_b++;
+            }
+
+            // Stores color into buffer by averaging the colors and mapping to [0, 255]
+            uint32_t idx = (j * width + i) * 3;
+            buffer[idx] = r / samples_per_pixel * 255;
+            buffer[idx + 1] = g / samples_per_pixel * 255;
+            buffer[idx + 2] = b / samples_per_pixel * 255;
+        }
+    }
+
+    return duplicate_pairs * PRECISION_TIER_DUPLICATE_RATIO <= neighbour_pairs;
+}
+
+/// @brief Mariani-Silver subdivision of a block. The border of a rectangle is evaluated
+/// first, and when every border sample has the same value, the inside is filled with
+/// the border color, since the set is connected. Otherwise the rectangle is split in
+/// four along a cross through its center, which becomes the border of the new rectangles.
+/// Escaped samples are smoothed, so in practice only the inside of the set is filled
+template <typename T, FractalType TYPE>
+class SubdividedBlock {
+public:
+    SubdividedBlock(
+        uint8_t* buffer,
+        const ImageSettings& image_settings,
+        const FractalSettings& fractal_settings,
+        const Camera& camera,
+        uint32_t x,
+        uint32_t y,
+        uint32_t width,
+        uint32_t height,
+        const Palette& palette,
+        const ReferenceOrbit* reference_orbit)
+        : buffer(buffer)
+        , fractal_settings(fractal_settings)
+        , palette(palette)
+        , reference_orbit(reference_orbit)
+        , width(width)
+        , height(height)
+        , n_samples((uint32_t)sqrt(image_settings.multi_sample_anti_aliasing))
+        , samples_per_pixel(n_samples * n_samples)
+        , perturbation(TYPE == FractalType::MANDELBROT && reference_orbit != nullptr)
+        , deep_deltas(false)
+        , resolved(true)
+        , neighbour_pairs(0)
+        , duplicate_pairs(0)
+        , pixel_t(width * height)
+    {
+        double aspect_ratio = (double)image_settings.width / (double)image_settings.height;
+
+        // Same coordinates as render_block_impl(), computed once per column and row
+        const TierCamera<T> tier_camera(camera);
+        floatexp delta_scale;
+        if (perturbation) {
+            delta_scale = perturbation_delta_scale(camera);
+            deep_deltas = delta_scale < floatexp(PERTURBATION_FLOATEXP_SCALE);
+        }
+        const double inverse_zoom = (double)delta_scale;
+
+        resize_coordinates(column_x, column_delta_x, column_deep_delta_x, width * n_samples);
+        resize_coordinates(row_y, row_delta_y, row_deep_delta_y, height * n_samples);
+        resize_span(std::max(width, height) * samples_per_pixel);
+
+        for (uint32_t i = 0; i < width; ++i) {
             for (uint32_t sx = 0; sx < n_samples; sx++) {
-                double sample_offset_x = (double)sx / n_samples;
-                double sample_x = pixel_x + pixel_size_x * sample_offset_x;
+                double nx = normalized_coordinate(x + i, sample_offset(sx, n_samples), image_settings.width) * aspect_ratio;
+                uint32_t index = i * n_samples + sx;
+
+                if (deep_deltas)
+                    column_deep_delta_x[index] = floatexp(nx) * delta_scale;
+                else if (perturbation)
+                    column_delta_x[index] = nx * inverse_zoom;
+                else
+                    tier_camera.to_world_x(nx, column_x[index]);
+            }
+
+            if (check_resolution && !perturbation && i > 0 && column_x[i * n_samples] == column_x[(i - 1) * n_samples])
+                resolved = false;
+        }
 
+        for (uint32_t j = 0; j < height; ++j) {
+            uint32_t pixel_y = image_settings.height - 1 - y - j;
+
+            for (uint32_t sy = 0; sy < n_samples; sy++) {
+                double ny = normalized_coordinate(pixel_y, sample_offset(sy, n_samples), image_settings.height);
+                uint32_t index = j * n_samples + sy;
+
+                if (deep_deltas)
+                    row_deep_delta_y[index] = floatexp(ny) * delta_scale;
+                else if (perturbation)
+                    row_delta_y[index] = ny * inverse_zoom;
+                else
+                    tier_camera.to_world_y(ny, row_y[index]);
+            }
+
+            if (check_resolution && !perturbation && j > 0 && row_y[j * n_samples] == row_y[(j - 1) * n_samples])
+                resolved = false;
+        }
+    }
+
+    /// @brief Returns false when T left the samples unresolved, like render_block_impl()
+    bool render()
+    {
+        if (!resolved)
+            return false;
+
+        // Border of the block
+        queue({ 0, 0, width, 1 });
+        if (height > 1)
+            queue({ 0, height - 1, width, 1 });
+        if (height > 2) {
+            queue({ 0, 1, 1, height - 2 });
+            if (width > 1)
+                queue({ width - 1, 1, 1, height - 2 });
+        }
+        evaluate_queued();
+
+        // Rectangles are subdivided level by level, and the pixels queued by a level
+        // are sampled together, so that the vector kernels get full batches
+        std::vector<Rectangle> pending = { { 0, 0, width, height } }, next;
+        while (!pending.empty()) {
+            next.clear();
+
+            for (const Rectangle& rectangle : pending) {
+                if (rectangle.width <= 2 || rectangle.height <= 2)
+                    continue;
+
+                uint32_t inner_x = rectangle.x + 1, inner_y = rectangle.y + 1;
+                uint32_t inner_width = rectangle.width - 2, inner_height = rectangle.height - 2;
+
+                if (is_border_uniform(rectangle)) {
+                    fill(rectangle);
+                    continue;
+                }
+
+                // Small rectangles are evaluated at once, a cross wouldn't save much
+                if (inner_width < SUBDIVISION_MIN_SIZE || inner_height < SUBDIVISION_MIN_SIZE) {
+                    queue({ inner_x, inner_y, inner_width, inner_height });
+                    continue;
+                }
+
+                uint32_t middle_x = rectangle.x + rectangle.width / 2;
+                uint32_t middle_y = rectangle.y + rectangle.height / 2;
+                queue({ inner_x, middle_y, inner_width, 1 });
+                queue({ middle_x, inner_y, 1, middle_y - inner_y });
+                queue({ middle_x, middle_y + 1, 1, inner_y + inner_height - middle_y - 1 });
+
+                uint32_t right_width = rectangle.x + rectangle.width - middle_x;
+                uint32_t bottom_height = rectangle.y + rectangle.height - middle_y;
+                next.push_back({ rectangle.x, rectangle.y, middle_x - rectangle.x + 1, middle_y - rectangle.y + 1 });
+                next.push_back({ middle_x, rectangle.y, right_width, middle_y - rectangle.y + 1 });
+                next.push_back({ rectangle.x, middle_y, middle_x - rectangle.x + 1, bottom_height });
+                next.push_back({ middle_x, middle_y, right_width, bottom_height });
+            }
+
+            evaluate_queued();
+            pending.swap(next);
+        }
+
+        return duplicate_pairs * PRECISION_TIER_DUPLICATE_RATIO <= neighbour_pairs;
+    }
+
+private:
+    /// @brief Pixels of the block, with its border already evaluated
+    struct Rectangle {
+        uint32_t x, y, width, height;
+    };
+
+    /// @brief Rectangles with fewer inner pixels per side are evaluated without subdividing
+    static constexpr uint32_t SUBDIVISION_MIN_SIZE = 4;
+
+    static constexpr bool check_resolution = !std::is_same<T, number>::value;
+
+    /// @brief Adds the pixels of the rectangle to the span, which is evaluated once
+    /// it's large enough to hold a row of the block, or when the level ends
+    void queue(const Rectangle& rectangle)
+    {
+        if (rectangle.width == 0 || rectangle.height == 0)
+            return;
+
+        // The next pixel of the span is a neighbour, except at the end of a row
+        for (uint32_t j = rectangle.y; j < rectangle.y + rectangle.height; ++j) {
+            for (uint32_t i = rectangle.x; i < rectangle.x + rectangle.width; ++i) {
+                bool last = i + 1 == rectangle.x + rectangle.width && (rectangle.width > 1 || j + 1 == rectangle.y + rectangle.height);
+                span_pixels.push_back(j * width + i);
+                span_neighbours.push_back(!last);
+            }
+        }
+
+        if (span_pixels.size() >= std::max(width, height))
+            evaluate_queued();
+    }
+
+    /// @brief Evaluates the queued pixels in a single span, and stores their colors
+    void evaluate_queued()
+    {
+        uint32_t length = span_pixels.size();
+        if (length == 0)
+            return;
+
+        // Samples of a pixel are ordered as in a row span of render_block_impl()
+        uint32_t count = length * samples_per_pixel;
+        if (span_t.size() < count)
+            resize_span(count);
+
+        for (uint32_t p = 0; p < length; ++p) {
+            uint32_t column = span_pixels[p] % width;
+            uint32_t row = span_pixels[p] / width;
+
+            for (uint32_t sx = 0; sx < n_samples; sx++) {
                 for (uint32_t sy = 0; sy < n_samples; sy++) {
+                    uint32_t k = (p * n_samples + sx) * n_samples + sy;
+                    if (deep_deltas) {
+                        span_deep_delta_x[k] = column_deep_delta_x[column * n_samples + sx];
+                        span_deep_delta_y[k] = row_deep_delta_y[row * n_samples + sy];
+                    } else if (perturbation) {
+                        span_delta_x[k] = column_delta_x[column * n_samples + sx];
+                        span_delta_y[k] = row_delta_y[row * n_samples + sy];
+                    } else {
+                        span_x[k] = column_x[column * n_samples + sx];
+                        span_y[k] = row_y[row * n_samples + sy];
+                    }
+                }
+            }
+        }
 
-                    // Random offset in [0, 1)
-                    double sample_offset_y = (double)sy / n_samples;
-                    double sample_y = pixel_y + pixel_size_y * sample_offset_y;
+        if (deep_deltas)
+            mandelbrot_perturbation_batch_sampler(span_deep_delta_x.data(), span_deep_delta_y.data(), span_t.data(), count, *reference_orbit, fractal_settings);
+        else if (perturbation)
+            mandelbrot_perturbation_batch_sampler(span_delta_x.data(), span_delta_y.data(), span_t.data(), count, *reference_orbit, fractal_settings);
+        else
+            sample_span<TYPE>(span_x.data(), span_y.data(), span_t.data(), count, fractal_settings);
 
-                    // Computes normalized coordinates in range [-0.5, 0.5]
-                    double nx = ((double)sample_x / image_settings.width - 0.5) * aspect_ratio;
-                    double ny = ((double)sample_y / image_settings.height - 0.5);
+        // Only neighbouring pixels of the span are compared, see render_block_impl()
+        if (check_resolution) {
+            for (uint32_t k = 0; k + samples_per_pixel < count; ++k) {
+                uint32_t next = k + samples_per_pixel;
+                if (!span_neighbours[k / samples_per_pixel])
+                    continue;
+
+                if (span_t[k] > 0.0f && span_t[k] < 1.0f && span_t[next] > 0.0f && span_t[next] < 1.0f) {
+                    neighbour_pairs++;
+                    duplicate_pairs += span_t[k] == span_t[next];
+                }
+            }
+        }
 
-                    // Computes world coordinates with camera
-                    number wx, wy;
-                    camera.to_world(nx, ny, wx, wy);
-                    float t = fractal_sampler(wx, wy, fractal_settings);
+        const float* t = span_t.data();
+        for (uint32_t p = 0; p < length; ++p) {
 
-                    // Clamps t in range [0.0, 1.0]
-                    if (t < 0.0f)
-                        t = 0.0f;
+            // NaN when the samples of the pixel differ, so the pixel never matches another
+            float uniform_t = t[0];
+            float r = 0.0f, g = 0.0f, b = 0.0f;
 
-                    else if (t > 1.0f)
-                        t = 1.0f;
+            for (uint32_t s = 0; s < samples_per_pixel; ++s) {
+                if (t[s] != uniform_t)
+                    uniform_t = NAN;
 
-                    float sample_r, sample_g, sample_b;
+                float sample_r, sample_g, sample_b;
+                palette.color(t[s], sample_r, sample_g, sample_b);
 
-                    color_function(
-                        t,
-                        sample_r,
-                        sample_g,
-                        sample_b);
+                r += sample_r;
+                g += sample_g;
+                b += sample_b;
+            }
+            t += samples_per_pixel;
 
-                    r += sample_r;
-                    g += sample_g;
-                    b += sample_b;
+            uint32_t idx = span_pixels[p] * 3;
+            buffer[idx] = r / samples_per_pixel * 255;
+            buffer[idx + 1] = g / samples_per_pixel * 255;
+            buffer[idx + 2] = b / samples_per_pixel * 255;
+            pixel_t[span_pixels[p]] = uniform_t;
+        }
+
+        span_pixels.clear();
+        span_neighbours.clear();
+    }
+
+    bool is_border_uniform(const Rectangle& rectangle) const
+    {
+        float border_t = pixel_t[rectangle.y * width + rectangle.x];
+        uint32_t right = rectangle.x + rectangle.width - 1;
+        uint32_t bottom = rectangle.y + rectangle.height - 1;
+
+        for (uint32_t i = rectangle.x; i <= right; ++i) {
+            if (!(pixel_t[rectangle.y * width + i] == border_t && pixel_t[bottom * width + i] == border_t))
+                return false;
+        }
+        for (uint32_t j = rectangle.y + 1; j < bottom; ++j) {
+            if (!(pixel_t[j * width + rectangle.x] == border_t && pixel_t[j * width + right] == border_t))
+                return false;
+        }
+        return true;
+    }
+
+    /// @brief Copies the color of the border into the inner pixels of the rectangle
+    void fill(const Rectangle& rectangle)
+    {
+        const uint8_t* color = buffer + (rectangle.y * width + rectangle.x) * 3;
+        float border_t = pixel_t[rectangle.y * width + rectangle.x];
+
+        for (uint32_t j = rectangle.y + 1; j < rectangle.y + rectangle.height - 1; ++j) {
+            for (uint32_t i = rectangle.x + 1; i < rectangle.x + rectangle.width - 1; ++i) {
+                uint32_t idx = (j * width + i) * 3;
+                buffer[idx] = color[0];
+                buffer[idx + 1] = color[1];
+                buffer[idx + 2] = color[2];
+                pixel_t[j * width + i] = border_t;
+            }
+        }
+    }
+
+    void resize_span(uint32_t samples)
+    {
+        resize_coordinates(span_x, span_delta_x, span_deep_delta_x, samples);
+        resize_coordinates(span_y, span_delta_y, span_deep_delta_y, samples);
+        span_t.resize(samples);
+    }
+
+    /// @brief Only the coordinates used by the sampling mode are allocated
+    void resize_coordinates(std::vector<T>& world, std::vector<double>& delta, std::vector<floatexp>& deep_delta, uint32_t size)
+    {
+        if (deep_deltas)
+            deep_delta.resize(size);
+        else if (perturbation)
+            delta.resize(size);
+        else
+            world.resize(size);
+    }
+
+    uint8_t* buffer;
+    const FractalSettings& fractal_settings;
+    const Palette& palette;
+    const ReferenceOrbit* reference_orbit;
+    uint32_t width, height;
+    uint32_t n_samples, samples_per_pixel;
+    bool perturbation, deep_deltas;
+    bool resolved;
+    uint32_t neighbour_pairs, duplicate_pairs;
+
+    /// @brief Value of every sample of a pixel, or NaN if they differ
+    std::vector<float> pixel_t;
+
+    // Coordinates of the samples of each column and row
+    std::vector<T> column_x, row_y;
+    std::vector<double> column_delta_x, row_delta_y;
+    std::vector<floatexp> column_deep_delta_x, row_deep_delta_y;
+
+    // Queued pixels, by their index in the block, and their samples
+    std::vector<uint32_t> span_pixels;
+    std::vector<bool> span_neighbours;
+    std::vector<T> span_x, span_y;
+    std::vector<double> span_delta_x, span_delta_y;
+    std::vector<floatexp> span_deep_delta_x, span_deep_delta_y;
+    std::vector<float> span_t;
+};
+
+template <typename T, FractalType TYPE>
+static bool render_block_subdivided_impl(
+    uint8_t* buffer,
+    float* field,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const Palette* palette,
+    const ReferenceOrbit* reference_orbit)
+{
+    // Fields keep every sample, so there's nothing to fill
+    if (field)
+        return render_block_impl<T, TYPE, 0>(buffer, field, image_settings, fractal_settings, camera, x, y, width, height, palette, reference_orbit);
+
+    SubdividedBlock<T, TYPE> block(buffer, image_settings, fractal_settings, camera, x, y, width, height, *palette, reference_orbit);
+    return block.render();
+}
+
+/// @brief Pixels are first evaluated every DISTANCE_FILL_STRIDE pixels, then on lattices
+/// of half the stride, down to every pixel left
+#define DISTANCE_FILL_STRIDE 16
+
+/// @brief Renders the block by evaluating its pixels on lattices of decreasing stride. The
+/// distance estimate of an evaluated pixel guarantees that the disk around it holds no point
+/// of the boundary, so the pixels inside are filled with its color without iterating them.
+/// Disks inside the set have its exact color. Outside, the color is approximate, which suits
+/// slowly varying colors
+template <FractalType TYPE>
+static bool render_block_distance_impl(
+    uint8_t* buffer,
+    float* field,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const Palette* palette,
+    const ReferenceOrbit* reference_orbit)
+{
+    // Perturbation doesn't track the derivative, and fields keep every sample, so
+    // every pixel is evaluated
+    if (reference_orbit != nullptr || field)
+        return render_block_impl<number, TYPE, 0>(buffer, field, image_settings, fractal_settings, camera, x, y, width, height, palette, reference_orbit);
+
+    const uint32_t n_samples = (uint32_t)sqrt(image_settings.multi_sample_anti_aliasing);
+    const uint32_t samples_per_pixel = n_samples * n_samples;
+
+    double aspect_ratio = (double)image_settings.width / (double)image_settings.height;
+
+    // Distances are measured in pixels, so zooms past the range of double fill nothing
+    double pixel_world_size = 1.0 / ((double)camera.zoom * image_settings.height);
+    if (!(pixel_world_size > 0.0) || !isfinite(pixel_world_size))
+        pixel_world_size = INFINITY;
+
+    // Same coordinates as render_block_impl(), computed once per column and row
+    const TierCamera<number> tier_camera(camera);
+    std::vector<number> column_x(width * n_samples), row_y(height * n_samples);
+    for (uint32_t i = 0; i < width; ++i) {
+        for (uint32_t sx = 0; sx < n_samples; sx++) {
+            double nx = normalized_coordinate(x + i, sample_offset(sx, n_samples), image_settings.width) * aspect_ratio;
+            tier_camera.to_world_x(nx, column_x[i * n_samples + sx]);
+        }
+    }
+    for (uint32_t j = 0; j < height; ++j) {
+        uint32_t pixel_y = image_settings.height - 1 - y - j;
+        for (uint32_t sy = 0; sy < n_samples; sy++) {
+            double ny = normalized_coordinate(pixel_y, sample_offset(sy, n_samples), image_settings.height);
+            tier_camera.to_world_y(ny, row_y[j * n_samples + sy]);
+        }
+    }
+
+    // Pixels either evaluated or filled
+    std::vector<bool> done(width * height);
+
+    // Pixels of the lattice, and their samples. The whole lattice is sampled at once, so the
+    // vector kernels get full lane groups even for the few pixels of the coarse lattices
+    std::vector<uint32_t> pixels;
+    std::vector<number> span_x, span_y;
+    std::vector<float> span_t;
+    std::vector<double> span_distance;
+
+    for (uint32_t stride = DISTANCE_FILL_STRIDE; stride > 0; stride /= 2) {
+        // Pixels of coarser lattices were already evaluated
+        pixels.clear();
+        for (uint32_t j = 0; j < height; j += stride) {
+            for (uint32_t i = 0; i < width; i += stride) {
+                if (!done[j * width + i])
+                    pixels.push_back(j * width + i);
+            }
+        }
+        if (pixels.empty())
+            continue;
+
+        uint32_t count = pixels.size() * samples_per_pixel;
+        span_x.resize(count);
+        span_y.resize(count);
+        span_t.resize(count);
+        span_distance.resize(count);
+
+        for (uint32_t p = 0; p < pixels.size(); ++p) {
+            uint32_t column = pixels[p] % width, row = pixels[p] / width;
+            for (uint32_t sx = 0; sx < n_samples; sx++) {
+                for (uint32_t sy = 0; sy < n_samples; sy++) {
+                    uint32_t k = (p * n_samples + sx) * n_samples + sy;
+                    span_x[k] = column_x[column * n_samples + sx];
+                    span_y[k] = row_y[row * n_samples + sy];
+                }
+            }
+        }
+
+        if (TYPE == FractalType::JULIA)
+            julia_distance_batch_sampler(span_x.data(), span_y.data(), span_t.data(), span_distance.data(), count, fractal_settings);
+        else
+            mandelbrot_distance_batch_sampler(span_x.data(), span_y.data(), span_t.data(), span_distance.data(), count, fractal_settings);
+
+        const float* t = span_t.data();
+        const double* distance = span_distance.data();
+        for (uint32_t p = 0; p < pixels.size(); ++p) {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            double pixel_distance = INFINITY;
+
+            for (uint32_t s = 0; s < samples_per_pixel; ++s) {
+                float sample_r, sample_g, sample_b;
+                palette->color(t[s], sample_r, sample_g, sample_b);
+
+                r += sample_r;
+                g += sample_g;
+                b += sample_b;
+                pixel_distance = std::min(pixel_distance, distance[s]);
+            }
+            t += samples_per_pixel;
+            distance += samples_per_pixel;
+
+            uint8_t* color = buffer + pixels[p] * 3;
+            color[0] = r / samples_per_pixel * 255;
+            color[1] = g / samples_per_pixel * 255;
+            color[2] = b / samples_per_pixel * 255;
+            done[pixels[p]] = true;
+
+            // The samples of a pixel are within a pixel of each other, so filled pixels
+            // need their whole extent inside the disk
+            double radius = std::min(pixel_distance / pixel_world_size, (double)std::max(width, height)) - 1.0;
+            if (radius < 1.0)
+                continue;
+
+            int32_t center_i = pixels[p] % width, center_j = pixels[p] / width;
+            int32_t extent = (int32_t)radius;
+            for (int32_t fj = std::max(center_j - extent, 0); fj <= std::min(center_j + extent, (int32_t)height - 1); ++fj) {
+                int32_t dj = fj - center_j;
+                int32_t half_width = (int32_t)sqrt(radius * radius - dj * dj);
+                for (int32_t fi = std::max(center_i - half_width, 0); fi <= std::min(center_i + half_width, (int32_t)width - 1); ++fi) {
+                    uint32_t index = fj * width + fi;
+                    if (done[index])
+                        continue;
+
+                    buffer[index * 3] = color[0];
+                    buffer[index * 3 + 1] = color[1];
+                    buffer[index * 3 + 2] = color[2];
+                    done[index] = true;
                 }
             }
+        }
+    }
 
-            // Stores color into buffer by averaging the colors and mapping to [0, 255]
-            uint32_t idx = (j * width + i) * 3;
-            buffer[idx] = r / image_settings.multi_sample_anti_aliasing * 255;
-            buffer[idx + 1] = g / image_settings.multi_sample_anti_aliasing * 255;
-            buffer[idx + 2] = b / image_settings.multi_sample_anti_aliasing * 255;
+    return true;
+}
+
+/// @brief Subdivision renders read the samples from the settings, since most of the
+/// time goes to the samplers. Distance fill iterates with the number of the build,
+/// since only its samplers track the derivative
+template <typename T, FractalType TYPE>
+static RenderBlockFunction* select_render_block(uint32_t n_samples, const FractalSettings& fractal_settings)
+{
+    if constexpr (std::is_same<T, number>::value) {
+        if (fractal_settings.distance_fill)
+            return render_block_distance_impl<TYPE>;
+    }
+
+    if (fractal_settings.subdivision)
+        return render_block_subdivided_impl<T, TYPE>;
+
+    switch (n_samples) {
+    case 1:
+        return render_block_impl<T, TYPE, 1>;
+    case 2:
+        return render_block_impl<T, TYPE, 2>;
+    case 3:
+        return render_block_impl<T, TYPE, 3>;
+    case 4:
+        return render_block_impl<T, TYPE, 4>;
+    default:
+        return render_block_impl<T, TYPE, 0>;
+    }
+}
+
+/// @brief Picks the render_block_impl instantiation that matches the settings
+template <typename T>
+static RenderBlockFunction* select_render_block(
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings)
+{
+    uint32_t n_samples = sqrt(image_settings.multi_sample_anti_aliasing);
+
+    switch (fractal_settings.type) {
+    case FractalType::MANDELBROT:
+        return select_render_block<T, FractalType::MANDELBROT>(n_samples, fractal_settings);
+    case FractalType::JULIA:
+        return select_render_block<T, FractalType::JULIA>(n_samples, fractal_settings);
+    default:
+        LOG_WARNING("Received unexpected fractal type: " << (int)fractal_settings.type << ". Using Mandelbrot by default");
+        return select_render_block<T, FractalType::MANDELBROT>(n_samples, fractal_settings);
+    }
+}
+
+/// @brief Instantiation for the number type of a precision tier below FULL
+static RenderBlockFunction* select_render_block(
+    PrecisionTier tier,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings)
+{
+    switch (tier) {
+#ifdef PRECISION_TIER_FLOAT
+    case PrecisionTier::FLOAT:
+        return select_render_block<float>(image_settings, fractal_settings);
+#endif
+#ifdef PRECISION_TIER_DOUBLE
+    case PrecisionTier::DOUBLE:
+        return select_render_block<double>(image_settings, fractal_settings);
+#endif
+#ifdef PRECISION_TIER_EXTENDED
+    case PrecisionTier::EXTENDED:
+        return select_render_block<double_double>(image_settings, fractal_settings);
+#endif
+    default:
+        return select_render_block<number>(image_settings, fractal_settings);
+    }
+}
+
+/// @brief Position in [0, 1) of a sample within its stratum, hashed from the pixel and the
+/// sample so that every process jitters the same way
+static inline double stratum_jitter(uint32_t pixel_x, uint32_t pixel_y, uint32_t sample)
+{
+    uint32_t h = pixel_x * 0x9E3779B1u ^ pixel_y * 0x85EBCA77u ^ sample * 0xC2B2AE3Du;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return (double)h / 4294967296.0;
+}
+
+/// @brief Jitter, in cell units, of the sample held by the cell of the n x n grid of a pixel.
+/// A cell holds the sample of the coarser grid that falls in it, or a sample of its own. The
+/// sample of the 1 x 1 grid is the one of the single sample render, at the center of the pixel
+static void held_sample_jitter(
+    uint32_t pixel_x,
+    uint32_t pixel_y,
+    uint32_t n_samples,
+    uint32_t cell_x,
+    uint32_t cell_y,
+    double& jitter_x,
+    double& jitter_y)
+{
+    if (n_samples == 1) {
+        jitter_x = jitter_y = 0.5;
+        return;
+    }
+
+    double coarse_x, coarse_y;
+    held_sample_jitter(pixel_x, pixel_y, n_samples / 2, cell_x / 2, cell_y / 2, coarse_x, coarse_y);
+    if (cell_x == (cell_x & ~1u) + (coarse_x >= 0.5) && cell_y == (cell_y & ~1u) + (coarse_y >= 0.5)) {
+        // Halving the cell doubles the jitter, which is exact
+        jitter_x = 2.0 * coarse_x - (coarse_x >= 0.5);
+        jitter_y = 2.0 * coarse_y - (coarse_y >= 0.5);
+        return;
+    }
+
+    // Samples are numbered from n^2, so every grid has its own
+    uint32_t sample = n_samples * n_samples + cell_x * n_samples + cell_y;
+    jitter_x = stratum_jitter(pixel_x, pixel_y, 2 * sample);
+    jitter_y = stratum_jitter(pixel_x, pixel_y, 2 * sample + 1);
+}
+
+/// @brief Adaptive anti-aliasing of a block rendered with a sample per pixel. Pixels whose
+/// color differs from a neighbour by more than the threshold are refined to a sample in
+/// each cell of a 2 x 2 grid, with jittered positions. Refined pixels whose samples still
+/// differ by more than the threshold get a sample in each cell of a grid twice as fine, as
+/// long as it fits in the budget. Every level keeps the samples of the previous one, which
+/// already fill a quarter of the cells, so n x n samples cost the same as uniform ones
+template <typename T>
+static void refine_block_impl(
+    uint8_t* buffer,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const Palette& palette,
+    const ReferenceOrbit* reference_orbit)
+{
+    const float threshold = image_settings.adaptive_threshold;
+
+    // Diagonal neighbours are compared as well, since features thinner than a pixel can
+    // cross a pixel diagonally between its horizontal and vertical neighbours
+    std::vector<uint32_t> pixels;
+    for (uint32_t j = 0; j < height; ++j) {
+        for (uint32_t i = 0; i < width; ++i) {
+            const uint8_t* color = buffer + (j * width + i) * 3;
+            int difference = 0;
+
+            for (uint32_t nj = j > 0 ? j - 1 : j; nj <= std::min(j + 1, height - 1); ++nj) {
+                for (uint32_t ni = i > 0 ? i - 1 : i; ni <= std::min(i + 1, width - 1); ++ni) {
+                    const uint8_t* neighbour = buffer + (nj * width + ni) * 3;
+                    for (int c = 0; c < 3; ++c)
+                        difference = std::max(difference, abs(color[c] - neighbour[c]));
+                }
+            }
+
+            if (difference > threshold * 255.0f)
+                pixels.push_back(j * width + i);
         }
     }
+
+    double aspect_ratio = (double)image_settings.width / (double)image_settings.height;
+    const bool perturbation = fractal_settings.type == FractalType::MANDELBROT && reference_orbit != nullptr;
+    const TierCamera<T> tier_camera(camera);
+    floatexp delta_scale;
+    bool deep_deltas = false;
+    if (perturbation) {
+        delta_scale = perturbation_delta_scale(camera);
+        deep_deltas = delta_scale < floatexp(PERTURBATION_FLOATEXP_SCALE);
+    }
+    const double inverse_zoom = (double)delta_scale;
+
+    // Sum of the sample colors of each pixel and their range, starting from the single sample
+    std::vector<float> color_sum(pixels.size() * 3), color_min(pixels.size() * 3), color_max(pixels.size() * 3);
+    for (uint32_t p = 0; p < pixels.size(); ++p) {
+        for (int c = 0; c < 3; ++c)
+            color_sum[p * 3 + c] = color_min[p * 3 + c] = color_max[p * 3 + c] = buffer[pixels[p] * 3 + c] / 255.0f;
+    }
+    std::vector<uint32_t> sample_count(pixels.size(), 1);
+
+    // Pixels refined by the current level
+    std::vector<uint32_t> refined(pixels.size());
+    for (uint32_t p = 0; p < pixels.size(); ++p)
+        refined[p] = p;
+
+    std::vector<T> world_x, world_y;
+    std::vector<double> delta_x, delta_y;
+    std::vector<floatexp> deep_delta_x, deep_delta_y;
+    std::vector<float> t;
+
+    uint32_t n_samples = 1;
+    for (; !refined.empty() && 4 * n_samples * n_samples <= (uint32_t)image_settings.adaptive_samples; n_samples *= 2) {
+        uint32_t fine_n = 2 * n_samples;
+
+        // Three new samples for each sample of the previous level, in a single span
+        uint32_t new_samples = 3 * n_samples * n_samples;
+        uint32_t count = refined.size() * new_samples;
+        if (deep_deltas) {
+            deep_delta_x.resize(count);
+            deep_delta_y.resize(count);
+        } else if (perturbation) {
+            delta_x.resize(count);
+            delta_y.resize(count);
+        } else {
+            world_x.resize(count);
+            world_y.resize(count);
+        }
+        t.resize(count);
+
+        uint32_t k = 0;
+        for (uint32_t r = 0; r < refined.size(); ++r) {
+            uint32_t pixel_x = x + pixels[refined[r]] % width;
+            uint32_t pixel_y = image_settings.height - 1 - y - pixels[refined[r]] / width;
+
+            for (uint32_t coarse_x = 0; coarse_x < n_samples; ++coarse_x) {
+                for (uint32_t coarse_y = 0; coarse_y < n_samples; ++coarse_y) {
+                    double held_x, held_y;
+                    held_sample_jitter(pixel_x, pixel_y, n_samples, coarse_x, coarse_y, held_x, held_y);
+                    uint32_t taken_x = 2 * coarse_x + (held_x >= 0.5);
+                    uint32_t taken_y = 2 * coarse_y + (held_y >= 0.5);
+
+                    for (uint32_t cell_x = 2 * coarse_x; cell_x < 2 * coarse_x + 2; ++cell_x) {
+                        for (uint32_t cell_y = 2 * coarse_y; cell_y < 2 * coarse_y + 2; ++cell_y) {
+                            if (cell_x == taken_x && cell_y == taken_y)
+                                continue;
+
+                            double jitter_x, jitter_y;
+                            held_sample_jitter(pixel_x, pixel_y, fine_n, cell_x, cell_y, jitter_x, jitter_y);
+                            // Cells span [-0.5, 0.5) around the pixel, like the grid of sample_offset()
+                            double nx = normalized_coordinate(pixel_x, (cell_x + jitter_x) / fine_n - 0.5, image_settings.width) * aspect_ratio;
+                            double ny = normalized_coordinate(pixel_y, (cell_y + jitter_y) / fine_n - 0.5, image_settings.height);
+
+                            if (deep_deltas) {
+                                deep_delta_x[k] = floatexp(nx) * delta_scale;
+                                deep_delta_y[k] = floatexp(ny) * delta_scale;
+                            } else if (perturbation) {
+                                delta_x[k] = nx * inverse_zoom;
+                                delta_y[k] = ny * inverse_zoom;
+                            } else {
+                                tier_camera.to_world_x(nx, world_x[k]);
+                                tier_camera.to_world_y(ny, world_y[k]);
+                            }
+                            k++;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (deep_deltas)
+            mandelbrot_perturbation_batch_sampler(deep_delta_x.data(), deep_delta_y.data(), t.data(), count, *reference_orbit, fractal_settings);
+        else if (perturbation)
+            mandelbrot_perturbation_batch_sampler(delta_x.data(), delta_y.data(), t.data(), count, *reference_orbit, fractal_settings);
+        else if (fractal_settings.type == FractalType::JULIA)
+            julia_batch_sampler(world_x.data(), world_y.data(), t.data(), count, fractal_settings);
+        else
+            mandelbrot_batch_sampler(world_x.data(), world_y.data(), t.data(), count, fractal_settings);
+
+        // Pixels whose samples differ are refined again by the next level
+        uint32_t next_refined = 0;
+        for (uint32_t r = 0; r < refined.size(); ++r) {
+            uint32_t p = refined[r];
+            bool differs = false;
+            sample_count[p] += new_samples;
+
+            for (uint32_t s = 0; s < new_samples; ++s) {
+                float rgb[3];
+                palette.color(t[r * new_samples + s], rgb[0], rgb[1], rgb[2]);
+
+                for (int c = 0; c < 3; ++c) {
+                    color_sum[p * 3 + c] += rgb[c];
+                    color_min[p * 3 + c] = std::min(color_min[p * 3 + c], rgb[c]);
+                    color_max[p * 3 + c] = std::max(color_max[p * 3 + c], rgb[c]);
+                }
+            }
+
+            for (int c = 0; c < 3; ++c)
+                differs |= color_max[p * 3 + c] - color_min[p * 3 + c] > threshold;
+
+            if (differs)
+                refined[next_refined++] = p;
+        }
+        refined.resize(next_refined);
+    }
+
+    for (uint32_t p = 0; p < pixels.size(); ++p) {
+        for (int c = 0; c < 3; ++c)
+            buffer[pixels[p] * 3 + c] = (uint8_t)(std::min(color_sum[p * 3 + c] / sample_count[p], 1.0f) * 255.0f);
+    }
+}
+
+/// @brief Refines the block with the number type it was rendered with, when adaptive
+/// anti-aliasing is enabled
+static void refine_block(
+    PrecisionTier tier,
+    uint8_t* buffer,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const Palette& palette,
+    const ReferenceOrbit* reference_orbit)
+{
+    if (image_settings.adaptive_samples < 4)
+        return;
+
+    switch (tier) {
+#ifdef PRECISION_TIER_FLOAT
+    case PrecisionTier::FLOAT:
+        refine_block_impl<float>(buffer, image_settings, fractal_settings, camera, x, y, width, height, palette, reference_orbit);
+        break;
+#endif
+#ifdef PRECISION_TIER_DOUBLE
+    case PrecisionTier::DOUBLE:
+        refine_block_impl<double>(buffer, image_settings, fractal_settings, camera, x, y, width, height, palette, reference_orbit);
+        break;
+#endif
+#ifdef PRECISION_TIER_EXTENDED
+    case PrecisionTier::EXTENDED:
+        refine_block_impl<double_double>(buffer, image_settings, fractal_settings, camera, x, y, width, height, palette, reference_orbit);
+        break;
+#endif
+    default:
+        refine_block_impl<number>(buffer, image_settings, fractal_settings, camera, x, y, width, height, palette, reference_orbit);
+        break;
+    }
+}
+
+/// @brief Renders the block with the fastest precision tier that resolves it, into colors
+/// or a field, see RenderBlockFunction
+static void render_block_samples(
+    uint8_t* buffer,
+    float* field,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const Palette* palette,
+    const ReferenceOrbit* reference_orbit)
+{
+    // Adaptive anti-aliasing renders a sample per pixel first, see refine_block_impl().
+    // Fields keep the uniform samples
+    ImageSettings block_settings = image_settings;
+    if (image_settings.adaptive_samples >= 4 && !field)
+        block_settings.multi_sample_anti_aliasing = 1;
+    else
+        block_settings.adaptive_samples = 0;
+
+    // Perturbation already iterates the pixels in double, so only direct sampling
+    // goes through the tiers. Distance fill has no tiers, see select_render_block()
+    if (fractal_settings.auto_precision && !fractal_settings.distance_fill && reference_orbit == nullptr) {
+        PrecisionTier tier = select_precision_tier(block_settings, fractal_settings, camera, x, y, width, height);
+
+        for (; tier != PrecisionTier::FULL; tier = next_precision_tier(tier)) {
+            RenderBlockFunction* render = select_render_block(tier, block_settings, fractal_settings);
+            if (render(buffer, field, block_settings, fractal_settings, camera, x, y, width, height, palette, nullptr)) {
+                if (!field)
+                    refine_block(tier, buffer, image_settings, fractal_settings, camera, x, y, width, height, *palette, nullptr);
+                return;
+            }
+
+            LOG_STATUS("Tile (" << x << ", " << y << ", " << width << ", " << height << ") isn't resolved with "
+                                << get_precision_tier_name(tier) << " precision. Rendering it again with the next tier");
+        }
+    }
+
+    RenderBlockFunction* render = select_render_block<number>(block_settings, fractal_settings);
+
+#ifdef USE_MP_ARENA
+    // Limbs allocated for the tile are recycled together once its numbers are destroyed
+    MpArenaScope arena_scope;
+#endif
+
+    render(
+        buffer,
+        field,
+        block_settings,
+        fractal_settings,
+        camera,
+        x,
+        y,
+        width,
+        height,
+        palette,
+        reference_orbit);
+
+    if (!field)
+        refine_block(PrecisionTier::FULL, buffer, image_settings, fractal_settings, camera, x, y, width, height, *palette, reference_orbit);
+
+#ifdef USE_MP_ARENA
+    MpArenaStats stats = arena_scope.stats();
+    LOG_STATUS("Tile (" << x << ", " << y << ", " << width << ", " << height << ") used "
+                        << stats.bytes << " bytes in " << stats.allocations << " limb allocations ("
+                        << stats.system_allocations << " from the system allocator)");
+#endif
+}
+
+void render_block(
+    uint8_t* buffer,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const Palette& palette,
+    const ReferenceOrbit* reference_orbit)
+{
+    render_block_samples(buffer, nullptr, image_settings, fractal_settings, camera, x, y, width, height, &palette, reference_orbit);
+}
+
+void render_block_field(
+    float* field,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const ReferenceOrbit* reference_orbit)
+{
+    render_block_samples(nullptr, field, image_settings, fractal_settings, camera, x, y, width, height, nullptr, reference_orbit);
 }
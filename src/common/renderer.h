@@ -3,7 +3,12 @@
 #include "settings/image_settings.h"
 #include "settings/fractal_settings.h"
 #include "settings/camera.h"
+#include "perturbation.h"
+#include "palette.h"
 
+/// @brief Renders the block at (x, y) of the image into buffer, as packed RGB rows
+/// @param palette Colors of the sampled values, built once per render
+/// @param reference_orbit When provided, Mandelbrot pixels are iterated as deltas from it
 void render_block(
     uint8_t* buffer,
     const ImageSettings& image_settings,
@@ -12,4 +17,20 @@ void render_block(
     uint32_t x,
     uint32_t y,
     uint32_t width,
-    uint32_t height);
\ No newline at end of file
+    uint32_t height,
+    const Palette& palette,
+    const ReferenceOrbit* reference_orbit = nullptr);
+
+/// @brief Renders the values of the samples of the block at (x, y) into field, as rows of
+/// width pixels with the samples of each pixel, instead of coloring them. Every sample is
+/// evaluated, so subdivision, distance fill and adaptive anti-aliasing don't apply
+void render_block_field(
+    float* field,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const ReferenceOrbit* reference_orbit = nullptr);
@@ -5,7 +5,7 @@ class Camera {
 
 public:
     number x, y;
-    number zoom;
+    zoom_number zoom;
 
     Camera()
         : x(0.0)
@@ -24,7 +24,38 @@ public:
         number& world_x,
         number& world_y) const
     {
-        world_x = (number)screen_normalized_x / zoom + x;
-        world_y = (number)screen_normalized_y / zoom + y;
+        to_world_x(screen_normalized_x, world_x);
+        to_world_y(screen_normalized_y, world_y);
+    }
+
+    /// @brief Each world axis only depends on the same screen axis, which lets
+    /// the renderer transform columns and rows separately
+    number to_world_x(double screen_normalized_x) const
+    {
+        number world_x;
+        to_world_x(screen_normalized_x, world_x);
+        return world_x;
+    }
+
+    number to_world_y(double screen_normalized_y) const
+    {
+        number world_y;
+        to_world_y(screen_normalized_y, world_y);
+        return world_y;
+    }
+
+    /// @brief Computes in place, so reusing world_x doesn't allocate with MPFR
+    void to_world_x(double screen_normalized_x, number& world_x) const
+    {
+        world_x = screen_normalized_x;
+        world_x /= zoom;
+        world_x += x;
+    }
+
+    void to_world_y(double screen_normalized_y, number& world_y) const
+    {
+        world_y = screen_normalized_y;
+        world_y /= zoom;
+        world_y += y;
     }
 };
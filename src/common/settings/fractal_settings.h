@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 
 enum class FractalType {
     MANDELBROT = 0,
@@ -34,17 +35,69 @@ struct JuliaSettings {
     }
 };
 
+/// @brief Most color stops of a user gradient
+#define GRADIENT_MAX_STOPS 64
+
+struct GradientStop {
+    /// @brief Position in [0, 1] and color components in [0, 1]
+    float position;
+    float r, g, b;
+};
+
+struct GradientSettings {
+
+    /// @brief Stops sorted by position. When there are any, the gradient replaces the color mode
+    uint32_t stop_count;
+    GradientStop stops[GRADIENT_MAX_STOPS];
+
+    GradientSettings()
+        : stop_count(0)
+    {
+    }
+};
+
 struct FractalSettings {
     int max_iterations;
     FractalType type;
     ColorMode color_mode;
 
     JuliaSettings julia_settings;
+    GradientSettings gradient;
+
+    /// @brief Iterates Mandelbrot pixels as double precision deltas from a
+    /// reference orbit computed at the camera center
+    bool perturbation;
+
+    /// @brief Renders each tile with the fastest number type that resolves its
+    /// pixels, before falling back to the number of the build
+    bool auto_precision;
+
+    /// @brief Stops iterating points of the main cardioid and period 2 bulb, and
+    /// orbits that repeat a point, since they never escape
+    bool interior_checks;
+
+    /// @brief Renders blocks with Mariani-Silver subdivision, which fills rectangles
+    /// whose border is uniform instead of evaluating their pixels
+    bool subdivision;
+
+    /// @brief Fills the pixels around escaped points with their color, as far as their
+    /// distance estimate guarantees there's no point of the set
+    bool distance_fill;
+
+    /// @brief Mirrors the blocks of the view that are symmetric to rendered pixels, about
+    /// the real axis for Mandelbrot and the origin for Julia, instead of scheduling them
+    bool symmetry;
 
     FractalSettings()
         : max_iterations(128)
         , color_mode(ColorMode::BLUE_GREEN_RED)
         , type(FractalType::MANDELBROT)
+        , perturbation(false)
+        , auto_precision(false)
+        , interior_checks(true)
+        , subdivision(false)
+        , distance_fill(false)
+        , symmetry(true)
     {
     }
 };
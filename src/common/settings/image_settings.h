@@ -8,10 +8,19 @@ struct ImageSettings {
     /// @brief Specifies the amount of iterations per pixel to avoid aliasing
     int multi_sample_anti_aliasing;
 
+    /// @brief Most samples of a pixel with adaptive anti-aliasing, which replaces the
+    /// uniform samples when it's 4 or more
+    int adaptive_samples;
+
+    /// @brief Color difference in [0, 1] above which adaptive anti-aliasing refines a pixel
+    float adaptive_threshold;
+
     ImageSettings()
-        : multi_sample_anti_aliasing(1)
-        , width(512)
+        : width(512)
         , height(512)
+        , multi_sample_anti_aliasing(1)
+        , adaptive_samples(0)
+        , adaptive_threshold(0.1f)
     {
     }
 };
\ No newline at end of file
@@ -3,7 +3,10 @@
 enum class OutputSettingsMode {
     DISK,
     NETWORK,
-    DISABLED
+    DISABLED,
+
+    // Smoothed iteration values of the samples, saved to disk_data.output_path
+    FIELD
 };
 
 struct OutputSetingsDiskData {
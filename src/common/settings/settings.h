@@ -8,6 +8,28 @@
 struct Settings {
 
     int block_size;
+
+    /// @brief Threads that render the tiles of a process, 0 uses every hardware thread
+    uint32_t threads;
+
+    /// @brief Task requests an MPI worker keeps in flight while it renders, on top of
+    /// the one of the task it renders
+    uint32_t prefetch;
+
+    /// @brief Whether the MPI master renders tasks between answering the workers
+    bool master_renders;
+
+    /// @brief Whether the MPI master dispatches the tasks from the most to the least
+    /// costly, as estimated by a low resolution pre-pass
+    bool cost_order;
+
+    /// @brief Whether the MPI master sends runs of tasks that shrink with the remaining
+    /// work, sized by the throughput of each rank, instead of the requested runs
+    bool guided;
+
+    /// @brief Whether MPI ranks claim tasks from an atomic counter in a window of the
+    /// master, instead of requesting them
+    bool rma_counter;
     ImageSettings image;
     Camera camera;
     FractalSettings fractal;
@@ -15,6 +37,12 @@ struct Settings {
 
     Settings()
         : block_size(32)
+        , threads(0)
+        , prefetch(1)
+        , master_renders(true)
+        , cost_order(false)
+        , guided(false)
+        , rma_counter(false)
     {
     }
 };
\ No newline at end of file
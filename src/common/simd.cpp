@@ -0,0 +1,35 @@
+#include "simd.h"
+
+static SimdLevel detect_simd_level()
+{
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+SimdLevel get_simd_level()
+{
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+const char* get_simd_level_name(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::SSE2:
+        return "SSE2";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    default:
+        return "Scalar";
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#endif
+
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+// Kernels are compiled per instruction set through target attributes, so the
+// binary keeps running on any x86-64 CPU and picks the widest path at runtime.
+// Contraction into FMA is disabled so that every path produces the same values,
+// which keeps tiles coming from different node generations consistent
+#ifdef SIMD_X86
+#define SIMD_TARGET_SSE2 __attribute__((optimize("fp-contract=off")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2"), optimize("fp-contract=off")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off")))
+#endif
+
+/// @brief Widest vector instruction set supported by the running CPU
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+/// @brief Detects the CPU features once and returns the cached result
+SimdLevel get_simd_level();
+
+const char* get_simd_level_name(SimdLevel level);
+
+/// @brief Register width in bytes of each level
+constexpr uint32_t simd_register_bytes(SimdLevel level)
+{
+    return level == SimdLevel::AVX512 ? 64
+        : level == SimdLevel::AVX2    ? 32
+        : level == SimdLevel::SSE2    ? 16
+                                      : 0;
+}
+
+/// @brief Two registers are iterated together to hide the latency of the
+/// multiply/add dependency chain of each fractal iteration
+#define SIMD_UNROLL 2
+
+/// @brief Number of points of type T that fit in a register of the given level
+template <typename T>
+constexpr int simd_lanes(SimdLevel level)
+{
+    return simd_register_bytes(level) / sizeof(T);
+}
+
+/// @brief N lanes of T, along with the integer vector produced by lane comparisons.
+/// Number types made of several doubles specialize it next to their definition
+template <typename T, int N>
+struct SimdLanes;
+
+/// @brief Native vectors of N lanes of T, where Int is the integer type of the same width
+template <typename T, typename Int, int N>
+struct SimdNativeLanes {
+    typedef T vec __attribute__((vector_size(N * sizeof(T))));
+    typedef Int mask __attribute__((vector_size(N * sizeof(Int))));
+
+    /// @brief Lanes in double, where the derivative of distance estimates is iterated
+    typedef double wide __attribute__((vector_size(N * sizeof(double))));
+    typedef int64_t wide_mask __attribute__((vector_size(N * sizeof(int64_t))));
+
+    /// @brief Registers of lanes iterated together by the kernels
+    static constexpr int unroll = SIMD_UNROLL;
+
+    static SIMD_INLINE void load(vec& dst, const T* src) { memcpy(&dst, src, sizeof(vec)); }
+    static SIMD_INLINE void broadcast(vec& dst, T value) { dst = vec {} + value; }
+    static SIMD_INLINE void less(mask& dst, const vec& a, const vec& b) { dst = a < b; }
+
+    /// @brief Copies the lanes of src where m is set into dst
+    static SIMD_INLINE void blend(vec& dst, const mask& m, const vec& src) { dst = m ? src : dst; }
+    static SIMD_INLINE T lane(const vec& v, int k) { return v[k]; }
+
+    static SIMD_INLINE void to_wide(wide& dst, const vec& v) { dst = __builtin_convertvector(v, wide); }
+    static SIMD_INLINE void blend_wide(wide& dst, const mask& m, const wide& src) { dst = __builtin_convertvector(m, wide_mask) ? src : dst; }
+};
+
+template <int N>
+struct SimdLanes<double, N> : SimdNativeLanes<double, int64_t, N> {
+};
+
+template <int N>
+struct SimdLanes<float, N> : SimdNativeLanes<float, int32_t, N> {
+};
+
+/// @brief Iterations between checks for lane groups where every lane escaped. Must be a power of two
+#define SIMD_EXIT_CHECK_INTERVAL 8
+
+/// @brief True if at least one lane of the U masks is set
+template <int N, int U, typename Mask>
+SIMD_INLINE bool simd_any(const Mask (&masks)[U])
+{
+    Mask any = masks[0];
+    for (int u = 1; u < U; ++u)
+        any |= masks[u];
+
+    for (int i = 0; i < N; ++i) {
+        if (any[i])
+            return true;
+    }
+    return false;
+}
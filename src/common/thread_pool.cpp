@@ -0,0 +1,167 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+ThreadPool::ThreadPool(uint32_t thread_count)
+    : thread_count(thread_count)
+    , batch(0)
+    , running_threads(0)
+    , stopping(false)
+    , function(nullptr)
+    , data(nullptr)
+{
+    if (this->thread_count == 0)
+        this->thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    ranges.reset(new TaskRange[this->thread_count]);
+
+    for (uint32_t thread = 0; thread + 1 < this->thread_count; ++thread)
+        threads.emplace_back(&ThreadPool::thread_main, this, thread);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_condition.notify_all();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void ThreadPool::run(uint32_t task_count, ThreadPoolFunction* function, void* data)
+{
+    // Every thread starts with an equal share of consecutive tasks
+    for (uint32_t thread = 0; thread < thread_count; ++thread) {
+        std::lock_guard<std::mutex> lock(ranges[thread].mutex);
+        ranges[thread].begin = (uint64_t)task_count * thread / thread_count;
+        ranges[thread].end = (uint64_t)task_count * (thread + 1) / thread_count;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->function = function;
+        this->data = data;
+        running_threads = threads.size();
+        ++batch;
+    }
+    start_condition.notify_all();
+
+    work(thread_count - 1);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running_threads > 0)
+        done_condition.wait(lock);
+}
+
+void ThreadPool::thread_main(uint32_t thread)
+{
+    uint64_t last_batch = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping && batch == last_batch)
+                start_condition.wait(lock);
+
+            if (stopping)
+                return;
+
+            last_batch = batch;
+        }
+
+        work(thread);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running_threads == 0)
+            done_condition.notify_one();
+    }
+}
+
+void ThreadPool::work(uint32_t thread)
+{
+    uint32_t task;
+    while (true) {
+        if (pop_task(thread, task))
+            function(task, thread, data);
+        else if (!steal_tasks(thread))
+            return;
+    }
+}
+
+bool ThreadPool::pop_task(uint32_t thread, uint32_t& task)
+{
+    TaskRange& range = ranges[thread];
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin == range.end)
+        return false;
+
+    task = range.begin++;
+    return true;
+}
+
+bool ThreadPool::steal_tasks(uint32_t thread)
+{
+    // Victims are visited from the next thread, so thieves spread over the team.
+    // A range taken by another thief is still run by it, so finding every range
+    // empty means the batch has no task left to start
+    for (uint32_t offset = 1; offset < thread_count; ++offset) {
+        TaskRange& victim = ranges[(thread + offset) % thread_count];
+        uint32_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin == victim.end)
+                continue;
+
+            // The owner keeps the first half, the one its next tiles are next to
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+
+        TaskRange& range = ranges[thread];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        range.begin = begin;
+        range.end = end;
+        return true;
+    }
+    return false;
+}
+
+static bool pin_thread(pthread_t thread, uint32_t cpu)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    return pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set) == 0;
+}
+
+bool ThreadPool::pin_threads(const std::vector<uint32_t>& cpus)
+{
+    if (cpus.empty())
+        return false;
+
+    bool pinned = pin_thread(pthread_self(), cpus[(thread_count - 1) % cpus.size()]);
+    for (uint32_t thread = 0; thread < threads.size(); ++thread)
+        pinned &= pin_thread(threads[thread].native_handle(), cpus[thread % cpus.size()]);
+
+    return pinned;
+}
+
+std::vector<uint32_t> get_available_cpus()
+{
+    std::vector<uint32_t> cpus;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0)
+        return cpus;
+
+    for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpu_set))
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// @brief Function run by ThreadPool::run() for each task. thread is in [0, thread count),
+/// so it can index per thread scratch memory
+typedef void ThreadPoolFunction(uint32_t task, uint32_t thread, void* data);
+
+/// @brief Fixed team of threads that runs batches of independent tasks. Each thread starts
+/// with a contiguous range of the task ids and takes them in order, which keeps neighbouring
+/// tiles on the same core. Threads that run out steal the back half of the range of another
+/// thread, so the slow tiles near the set don't leave the other cores idle
+class ThreadPool {
+public:
+    /// @brief Starts thread_count - 1 threads, the thread that calls run() is the last one.
+    /// A count of 0 uses every hardware thread
+    ThreadPool(uint32_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32_t get_thread_count() const { return thread_count; }
+
+    /// @brief Pins every thread to cpus[thread % cpus.size()]. It's called from the thread
+    /// that calls run(), which is pinned as the last thread
+    bool pin_threads(const std::vector<uint32_t>& cpus);
+
+    /// @brief Runs function for every task in [0, task_count), and returns once all of
+    /// them finished
+    void run(uint32_t task_count, ThreadPoolFunction* function, void* data);
+
+private:
+    /// @brief Task ids [begin, end) left to a thread
+    struct TaskRange {
+        std::mutex mutex;
+        uint32_t begin = 0, end = 0;
+    };
+
+    void thread_main(uint32_t thread);
+    void work(uint32_t thread);
+    bool pop_task(uint32_t thread, uint32_t& task);
+    bool steal_tasks(uint32_t thread);
+
+    uint32_t thread_count;
+    std::vector<std::thread> threads;
+    std::unique_ptr<TaskRange[]> ranges;
+
+    // Batch shared with the threads, guarded by mutex
+    std::mutex mutex;
+    std::condition_variable start_condition, done_condition;
+    uint64_t batch;
+    uint32_t running_threads;
+    bool stopping;
+    ThreadPoolFunction* function;
+    void* data;
+};
+
+/// @brief CPUs the process may run on, which the MPI launcher may have restricted
+std::vector<uint32_t> get_available_cpus();
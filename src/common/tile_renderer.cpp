@@ -0,0 +1,147 @@
+#include "tile_renderer.h"
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+/// @brief Block shared by the threads that render its tiles. Each thread renders into
+/// its own scratch tile, and copies it into the rows of the block
+struct TiledBlock {
+    uint8_t* buffer;
+    float* field;
+    const ImageSettings* image_settings;
+    const FractalSettings* fractal_settings;
+    const Camera* camera;
+    uint32_t x, y, width, height;
+    uint32_t tile_size, tiles_x;
+    const Palette* palette;
+    const ReferenceOrbit* reference_orbit;
+
+    // Bytes of a pixel in buffer, or floats of a pixel in field
+    uint32_t pixel_values;
+    std::vector<std::vector<uint8_t>> thread_buffers;
+    std::vector<std::vector<float>> thread_fields;
+};
+
+template <typename T>
+static void copy_tile(const T* tile, T* block, uint32_t block_width, uint32_t tile_x, uint32_t tile_y, uint32_t width, uint32_t height, uint32_t pixel_values)
+{
+    for (uint32_t j = 0; j < height; ++j) {
+        memcpy(
+            block + ((uint64_t)(tile_y + j) * block_width + tile_x) * pixel_values,
+            tile + (uint64_t)j * width * pixel_values,
+            (size_t)width * pixel_values * sizeof(T));
+    }
+}
+
+static void render_tile(uint32_t task, uint32_t thread, void* data)
+{
+    TiledBlock& block = *(TiledBlock*)data;
+
+    // Tile position relative to the block
+    uint32_t tile_x = (task % block.tiles_x) * block.tile_size;
+    uint32_t tile_y = (task / block.tiles_x) * block.tile_size;
+    uint32_t width = std::min(block.tile_size, block.width - tile_x);
+    uint32_t height = std::min(block.tile_size, block.height - tile_y);
+
+    // The first tile of a thread allocates its scratch, so the pages are touched first
+    // by the core that renders into them
+    uint64_t tile_values = (uint64_t)block.tile_size * block.tile_size * block.pixel_values;
+
+    if (block.field) {
+        if (block.thread_fields[thread].empty())
+            block.thread_fields[thread].resize(tile_values);
+
+        float* tile = block.thread_fields[thread].data();
+        render_block_field(
+            tile,
+            *block.image_settings,
+            *block.fractal_settings,
+            *block.camera,
+            block.x + tile_x,
+            block.y + tile_y,
+            width,
+            height,
+            block.reference_orbit);
+
+        copy_tile(tile, block.field, block.width, tile_x, tile_y, width, height, block.pixel_values);
+        return;
+    }
+
+    if (block.thread_buffers[thread].empty())
+        block.thread_buffers[thread].resize(tile_values);
+
+    uint8_t* tile = block.thread_buffers[thread].data();
+    render_block(
+        tile,
+        *block.image_settings,
+        *block.fractal_settings,
+        *block.camera,
+        block.x + tile_x,
+        block.y + tile_y,
+        width,
+        height,
+        *block.palette,
+        block.reference_orbit);
+
+    copy_tile(tile, block.buffer, block.width, tile_x, tile_y, width, height, block.pixel_values);
+}
+
+static void render_tiles(ThreadPool& pool, TiledBlock& block)
+{
+    block.tiles_x = (block.width + block.tile_size - 1) / block.tile_size;
+    uint32_t tiles_y = (block.height + block.tile_size - 1) / block.tile_size;
+
+    // Scratch tiles are allocated by render_tile(), in the thread that uses them
+    if (block.field)
+        block.thread_fields.resize(pool.get_thread_count());
+    else
+        block.thread_buffers.resize(pool.get_thread_count());
+
+    pool.run(block.tiles_x * tiles_y, render_tile, &block);
+}
+
+void render_block_tiles(
+    ThreadPool& pool,
+    uint32_t tile_size,
+    uint8_t* buffer,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const Palette& palette,
+    const ReferenceOrbit* reference_orbit)
+{
+    // A single tile is rendered in place
+    if (width <= tile_size && height <= tile_size) {
+        render_block(buffer, image_settings, fractal_settings, camera, x, y, width, height, palette, reference_orbit);
+        return;
+    }
+
+    TiledBlock block = { buffer, nullptr, &image_settings, &fractal_settings, &camera, x, y, width, height, tile_size, 0, &palette, reference_orbit, 3, {}, {} };
+    render_tiles(pool, block);
+}
+
+void render_block_field_tiles(
+    ThreadPool& pool,
+    uint32_t tile_size,
+    float* field,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const ReferenceOrbit* reference_orbit)
+{
+    if (width <= tile_size && height <= tile_size) {
+        render_block_field(field, image_settings, fractal_settings, camera, x, y, width, height, reference_orbit);
+        return;
+    }
+
+    TiledBlock block = { nullptr, field, &image_settings, &fractal_settings, &camera, x, y, width, height, tile_size, 0, nullptr, reference_orbit, (uint32_t)image_settings.multi_sample_anti_aliasing, {}, {} };
+    render_tiles(pool, block);
+}
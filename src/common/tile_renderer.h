@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+#include "renderer.h"
+#include "thread_pool.h"
+
+/// @brief Renders the block at (x, y) like render_block(), split into tiles of tile_size
+/// pixels that the threads of the pool render. Tiles are the same for any number of
+/// threads, so the image doesn't depend on it
+void render_block_tiles(
+    ThreadPool& pool,
+    uint32_t tile_size,
+    uint8_t* buffer,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const Palette& palette,
+    const ReferenceOrbit* reference_orbit = nullptr);
+
+/// @brief Renders the samples of the block at (x, y) like render_block_field(), split into
+/// tiles of tile_size pixels that the threads of the pool render
+void render_block_field_tiles(
+    ThreadPool& pool,
+    uint32_t tile_size,
+    float* field,
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    const ReferenceOrbit* reference_orbit = nullptr);
@@ -1,15 +1,52 @@
 #include "common/common.h"
 #include "common/logging.h"
+#include "common/simd.h"
+#include "common/perturbation.h"
+#include "common/thread_pool.h"
 #include "master.h"
 #include "worker.h"
 #include "mpi/mpi.h"
+#include <thread>
+#include <vector>
+
+/// @brief Threads of the worker and the CPUs they are pinned to. Ranks bound to some
+/// CPUs by the launcher use those. Otherwise the ranks of a node share its CPUs, each
+/// taking the run of CPUs of its node rank. A thread count of 0 uses the share of the rank
+static uint32_t get_worker_cpus(uint32_t threads, std::vector<uint32_t>& cpus)
+{
+    MPI_Comm node_comm;
+    int node_rank, node_size;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Comm_size(node_comm, &node_size);
+    MPI_Comm_free(&node_comm);
+
+    std::vector<uint32_t> available = get_available_cpus();
+    if (available.empty())
+        return std::max(1u, threads);
+
+    if (available.size() < std::thread::hardware_concurrency()) {
+        cpus = available;
+        return threads > 0 ? threads : available.size();
+    }
+
+    if (threads == 0)
+        threads = std::max<uint32_t>(1, available.size() / node_size);
+
+    for (uint32_t thread = 0; thread < threads; ++thread)
+        cpus.push_back(available[((uint64_t)node_rank * threads + thread) % available.size()]);
+
+    return threads;
+}
 
 int main(int argc, char** argv)
 {
 
     Settings settings;
 
-    MPI_Init(&argc, &argv);
+    // Only the main thread of a rank calls MPI, the threads of the workers just render
+    int thread_support;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
 
     int rank, num_procs;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -23,9 +60,20 @@ int main(int argc, char** argv)
         LOG("SETTINGS");
         LOG("- Image resolution(" << settings.image.width << "x" << settings.image.height << ")");
         LOG("- Block size(" << settings.block_size << ")");
+        LOG("- Prefetched requests(" << settings.prefetch << ")");
+        LOG("- Task order(" << (settings.cost_order ? "estimated cost" : "raster") << ")");
+        LOG("- Guided scheduling(" << (settings.guided ? "on" : "off") << ")");
+        LOG("- Dispatch(" << (settings.rma_counter ? "RMA counter" : "master requests") << ")");
+        LOG("- Threads per worker(" << (settings.threads > 0 ? std::to_string(settings.threads) : "auto") << ")");
+
+        if (thread_support < MPI_THREAD_FUNNELED && settings.threads != 1) {
+            LOG_WARNING("The MPI library doesn't support threads. Workers render with a single thread");
+            settings.threads = 1;
+        }
         LOG("- Camera(x=" << (double)settings.camera.x << ", y=" << (double)settings.camera.y << ", zoom=" << (double)settings.camera.zoom << ")");
         LOG("- Max Iterations(" << settings.fractal.max_iterations << ")");
         LOG("- Type(" << (int)settings.fractal.type << ")");
+        LOG("- SIMD(" << get_simd_level_name(get_simd_level()) << ")");
     }
 
     MPI_Bcast(&run_program, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
@@ -39,8 +87,16 @@ int main(int argc, char** argv)
     MPI_Bcast(&settings.image.width, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&settings.image.height, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&settings.image.multi_sample_anti_aliasing, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&settings.image.adaptive_samples, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&settings.image.adaptive_threshold, 1, MPI_FLOAT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&settings.block_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&settings.threads, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&settings.prefetch, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&settings.cost_order, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&settings.guided, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&settings.rma_counter, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
     MPI_Bcast(&settings.fractal, sizeof(FractalSettings), MPI_BYTE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&settings.output_settings.mode, sizeof(OutputSettingsMode), MPI_BYTE, 0, MPI_COMM_WORLD);
 
     // Camera position and zoom can't don't fit in 128bits, therefore sending those numbers
     // as a string is necessary
@@ -60,18 +116,47 @@ int main(int argc, char** argv)
     DESERIALIZE_NUM(settings.camera.y, camera_position_y);
     DESERIALIZE_NUM(settings.camera.zoom, camera_zoom);
 
+    // The reference orbit is iterated once by the master, at full precision,
+    // and shared with all the workers
+    ReferenceOrbit reference_orbit;
+    if (settings.fractal.perturbation) {
+        uint32_t orbit_length = 0;
+
+        if (rank == 0) {
+            compute_reference_orbit(settings.camera, settings.fractal, reference_orbit);
+            orbit_length = reference_orbit.length();
+            LOG_STATUS("Reference orbit computed with " << orbit_length << " points");
+        }
+
+        MPI_Bcast(&orbit_length, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
+        reference_orbit.x.resize(orbit_length);
+        reference_orbit.y.resize(orbit_length);
+        MPI_Bcast(reference_orbit.x.data(), orbit_length, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        MPI_Bcast(reference_orbit.y.data(), orbit_length, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    }
+
+    // Every rank takes part in splitting the nodes, and the master renders with its share
+    std::vector<uint32_t> worker_cpus;
+    uint32_t worker_threads = get_worker_cpus(settings.threads, worker_cpus);
+
     // Runs Master/Worker functions
     if (rank == 0) {
-        master(num_procs, settings);
+        master(
+            num_procs,
+            settings,
+            worker_threads,
+            worker_cpus,
+            settings.fractal.perturbation ? &reference_orbit : nullptr);
     }
 
     else {
         worker(
             rank,
-            settings.block_size,
-            settings.image,
-            settings.camera,
-            settings.fractal);
+            num_procs,
+            settings,
+            worker_threads,
+            worker_cpus,
+            settings.fractal.perturbation ? &reference_orbit : nullptr);
     }
 
     MPI_Finalize();
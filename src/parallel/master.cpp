@@ -2,75 +2,633 @@
 #include <mpi/mpi.h>
 #include <cstdint>
 #include <cmath>
+#include <algorithm>
 #include <chrono>
 #include "parallel/master.h"
+#include "tile_codec.h"
+#include "task_cost.h"
+#include "task_counter.h"
 #include "common/output_handler.h"
 #include "common/logging.h"
+#include "common/field_file.h"
+#include "common/renderer.h"
+#include "common/thread_pool.h"
 #include <string.h>
+#include <vector>
+
+/// @brief Copies the pixels of the blocks that weren't scheduled from their mirror
+static void mirror_skipped_blocks(
+    uint8_t* image,
+    const ImageSymmetry& symmetry,
+    uint32_t block_size,
+    uint32_t width,
+    uint32_t height)
+{
+    uint32_t row_end = std::min(symmetry.skipped_rows_end * block_size, height);
+    uint32_t column_begin = symmetry.skipped_columns_begin * block_size;
+    uint32_t column_end = std::min(symmetry.skipped_columns_end * block_size, width);
+
+    for (uint32_t row = symmetry.skipped_rows_begin * block_size; row < row_end; ++row) {
+        uint8_t* dest_row = &image[3 * row * width];
+        const uint8_t* src_row = &image[3 * (symmetry.row_sum - row) * width];
+
+        if (!symmetry.mirror_columns) {
+            memcpy(dest_row + 3 * column_begin, src_row + 3 * column_begin, (column_end - column_begin) * 3);
+            continue;
+        }
+
+        for (uint32_t column = column_begin; column < column_end; ++column)
+            memcpy(dest_row + 3 * column, src_row + 3 * (symmetry.column_sum - column), 3);
+    }
+}
+
+/// @brief Field counterpart of mirror_skipped_blocks(). The samples within each pixel are
+/// mirrored as well, since they are ordered by sample x and y
+static void mirror_skipped_field(
+    FieldFile& field_file,
+    const ImageSymmetry& symmetry,
+    uint32_t block_size,
+    uint32_t width,
+    uint32_t height,
+    uint32_t n_samples)
+{
+    uint32_t row_end = std::min(symmetry.skipped_rows_end * block_size, height);
+    uint32_t column_begin = symmetry.skipped_columns_begin * block_size;
+    uint32_t column_end = std::min(symmetry.skipped_columns_end * block_size, width);
+
+    for (uint32_t row = symmetry.skipped_rows_begin * block_size; row < row_end; ++row) {
+        for (uint32_t column = column_begin; column < column_end; ++column) {
+            uint32_t source_column = symmetry.mirror_columns ? symmetry.column_sum - column : column;
+            const float* source = field_file.get_pixel(source_column, symmetry.row_sum - row);
+            float* destination = field_file.get_pixel(column, row);
+
+            for (uint32_t sx = 0; sx < n_samples; ++sx) {
+                uint32_t source_sx = symmetry.mirror_columns ? n_samples - 1 - sx : sx;
+                for (uint32_t sy = 0; sy < n_samples; ++sy)
+                    destination[sx * n_samples + sy] = source[source_sx * n_samples + n_samples - 1 - sy];
+            }
+        }
+    }
+}
+
+/// @brief Answers a request of a worker with the next run of tasks, or terminates it
+/// when every task was sent
+static void send_tasks(
+    uint32_t worker,
+    uint64_t run_length,
+    uint64_t num_tasks,
+    uint64_t& sent_task_count)
+{
+    if (sent_task_count < num_tasks) {
+        // Sends a run of consecutive tasks to worker
+        uint64_t task_range[2] = { sent_task_count, std::min<uint64_t>(run_length, num_tasks - sent_task_count) };
+        sent_task_count += task_range[1];
+        MPI_Send(task_range, 2, MPI_UINT64_T, worker, Tag::TASK, MPI_COMM_WORLD);
+    } else {
+        MPI_Send(NULL, 0, MPI_BYTE, worker, Tag::TERMINATE, MPI_COMM_WORLD);
+    }
+}
+
+/// @brief Receive buffer of the master, holding a result message while it arrives. The
+/// tasks rendered by the master are kept unencoded in buffer or field instead
+struct MasterResult {
+    uint64_t first_task_id;
+    uint32_t task_count;
+    uint32_t source;
+    std::vector<uint8_t> message;
+    std::vector<uint8_t> buffer;
+    std::vector<float> field;
+
+    /// @brief Seconds each task took to render
+    std::vector<float> seconds;
+};
+
+/// @brief Copies the blocks rendered by the master into the image, or into the field
+/// file when one is given
+static void assemble_result(
+    const MasterResult& result,
+    uint8_t* image,
+    FieldFile* field_file,
+    const Settings& settings,
+    const ImageSymmetry& symmetry,
+    const TaskSchedule& schedule)
+{
+    uint32_t block_buffer_size = settings.block_size * settings.block_size * 3;
+    uint32_t block_field_size = settings.block_size * settings.block_size * settings.image.multi_sample_anti_aliasing;
+
+    for (uint32_t task = 0; task < result.task_count; ++task) {
+        WorkerTask block = get_task_by_id(
+            schedule.get_task_id(result.first_task_id + task),
+            settings.block_size,
+            settings.image.width,
+            settings.image.height,
+            symmetry);
+
+        if (image == nullptr) {
+            if (field_file)
+                field_file->write_block(&result.field[(size_t)block_field_size * task], block.x, block.y, block.width, block.height);
+            continue;
+        }
+
+        // Copies subimage buffer into main image buffer
+        const uint8_t* block_buffer = &result.buffer[(size_t)block_buffer_size * task];
+        for (uint32_t j = 0; j < block.height; ++j) {
+            uint32_t dest_index = 3 * ((block.y + j) * settings.image.width + block.x);
+            uint8_t* dest_ptr = &image[dest_index];
+            const uint8_t* src_ptr = &block_buffer[j * block.width * 3];
+            memcpy(dest_ptr, src_ptr, block.width * sizeof(uint8_t) * 3);
+        }
+    }
+}
+
+/// @brief Decodes the tiles of a result message of a worker straight into the image, or
+/// through field_tile into the field file when one is given. Adds the size of the raw
+/// tiles to raw_bytes, and returns false when the message is malformed
+static bool decode_result(
+    MasterResult& result,
+    uint32_t message_size,
+    uint8_t* image,
+    FieldFile* field_file,
+    std::vector<float>& field_tile,
+    const Settings& settings,
+    uint64_t& raw_bytes)
+{
+    ResultHeader header;
+    if (message_size < sizeof(ResultHeader))
+        return false;
+    memcpy(&header, result.message.data(), sizeof(ResultHeader));
+    result.first_task_id = header.first_task_id;
+    result.task_count = header.task_count;
+    result.seconds.resize(header.task_count);
+
+    uint32_t pixel_size = image ? 3 : settings.image.multi_sample_anti_aliasing * sizeof(float);
+    uint64_t offset = sizeof(ResultHeader);
+
+    for (uint32_t task = 0; task < header.task_count; ++task) {
+        TileHeader tile;
+        if (offset + sizeof(TileHeader) > message_size)
+            return false;
+        memcpy(&tile, &result.message[offset], sizeof(TileHeader));
+        offset += sizeof(TileHeader);
+
+        if (offset + tile.size > message_size
+            || tile.x + (uint64_t)tile.width > (uint64_t)settings.image.width
+            || tile.y + (uint64_t)tile.height > (uint64_t)settings.image.height
+            || tile.width > (uint32_t)settings.block_size
+            || tile.height > (uint32_t)settings.block_size)
+            return false;
+
+        const uint8_t* encoded = &result.message[offset];
+        offset += tile.size;
+        uint32_t row_size = tile.width * pixel_size;
+        raw_bytes += (uint64_t)row_size * tile.height;
+        result.seconds[task] = tile.render_seconds;
+
+        if (image) {
+            size_t stride = (size_t)settings.image.width * 3;
+            uint8_t* rows = image + tile.y * stride + (size_t)tile.x * 3;
+            if (!decode_tile(tile.codec, encoded, tile.size, pixel_size, rows, row_size, tile.height, stride))
+                return false;
+            continue;
+        }
+
+        if (!field_file)
+            continue;
+
+        field_tile.resize((size_t)settings.block_size * settings.block_size * settings.image.multi_sample_anti_aliasing);
+        if (!decode_tile(tile.codec, encoded, tile.size, pixel_size, (uint8_t*)field_tile.data(), row_size, tile.height, row_size))
+            return false;
+        field_file->write_block(field_tile.data(), tile.x, tile.y, tile.width, tile.height);
+    }
+    return offset == message_size;
+}
+
+struct RankThroughput {
+    uint64_t tasks = 0;
+    double seconds = 0.0;
+};
+
+/// @brief Dispatch and assembly state of the master, shared by its polling loop and the
+/// tiles it renders between polls
+struct MasterState {
+    const Settings* settings;
+    const ImageSymmetry* symmetry;
+    const TaskSchedule* schedule;
+
+    // Counter the ranks claim tasks from, without requests, or null. sent_task_count
+    // then follows the claims
+    TaskCounter* counter;
+    uint64_t num_tasks;
+    uint64_t sent_task_count;
+    uint64_t completed_task_count;
+    bool output_field;
+    uint8_t* image;
+    FieldFile* assembled_field;
+
+    // Results are received into a pool of messages, which grow to the largest result,
+    // while the master goes on answering the workers
+    std::vector<MasterResult> results;
+    std::vector<MPI_Request> receive_requests;
+    std::vector<MPI_Status> receive_statuses;
+    std::vector<int> received_results;
+    uint32_t pending_results;
+    std::vector<float> field_tile;
+
+    // Bytes of the received results, and of their raw pixels
+    uint64_t received_bytes, raw_bytes;
+
+    // Estimated and actual seconds of each task id, when the tasks are ordered by cost
+    std::vector<float> estimated_costs, actual_costs;
+
+    // Tasks each rank completed and the seconds it took to render them, which size the
+    // runs of guided scheduling. Ranks from first_rendering_rank render tasks
+    std::vector<RankThroughput> throughput;
+    uint32_t first_rendering_rank;
+
+    // When the last task was sent. What follows is the tail, where ranks run out of tasks
+    std::chrono::high_resolution_clock::time_point all_sent_time;
+    bool all_sent;
+
+    // Tasks the master renders itself
+    MasterResult rendered;
+    const Palette* palette;
+    const ReferenceOrbit* reference_orbit;
+    uint32_t main_thread;
+};
+
+/// @brief Tasks to send to a rank that requested runs of requested_tasks. Guided scheduling
+/// sends its share of the remaining tasks by throughput instead, where ranks that haven't
+/// completed a run yet count with the mean throughput of the others
+static uint64_t get_run_length(const MasterState& state, uint32_t rank, uint32_t requested_tasks)
+{
+    if (!state.settings->guided)
+        return requested_tasks;
+
+    double total_throughput = 0.0;
+    uint32_t measured_ranks = 0;
+    for (uint32_t r = state.first_rendering_rank; r < state.throughput.size(); ++r) {
+        if (state.throughput[r].seconds > 0.0) {
+            total_throughput += state.throughput[r].tasks / state.throughput[r].seconds;
+            ++measured_ranks;
+        }
+    }
+
+    double mean_throughput = measured_ranks > 0 ? total_throughput / measured_ranks : 1.0;
+    const RankThroughput& rank_throughput = state.throughput[rank];
+    double share = (rank_throughput.seconds > 0.0 ? rank_throughput.tasks / rank_throughput.seconds : mean_throughput)
+        / (total_throughput + mean_throughput * (state.throughput.size() - state.first_rendering_rank - measured_ranks));
+
+    // Workers hold a run for each request they keep in flight, the master a single one
+    uint32_t runs_in_flight = rank == 0 ? 1 : 1 + state.settings->prefetch;
+    uint64_t remaining_tasks = state.num_tasks - state.sent_task_count;
+    uint64_t run_length = ceil(remaining_tasks * share / (GUIDED_CHUNK_DIVISOR * runs_in_flight));
+    return std::max<uint64_t>(run_length, requested_tasks);
+}
+
+static void check_all_sent(MasterState& state)
+{
+    if (!state.all_sent && state.sent_task_count == state.num_tasks) {
+        state.all_sent = true;
+        state.all_sent_time = std::chrono::high_resolution_clock::now();
+    }
+}
+
+static void log_completed(MasterState& state, const MasterResult& result)
+{
+    if (!state.actual_costs.empty()) {
+        for (uint32_t task = 0; task < result.task_count; ++task)
+            state.actual_costs[state.schedule->get_task_id(result.first_task_id + task)] = result.seconds[task];
+    }
+
+    state.completed_task_count += result.task_count;
+    float progress = 100.0 * (float)state.completed_task_count / state.num_tasks;
+    if (result.source == 0) {
+        LOG_STATUS("Master completed " << result.task_count << " tasks. " << progress << "%");
+    } else {
+        LOG_STATUS("Worker " << result.source << " completed " << result.task_count << " tasks. " << progress << "%");
+    }
+}
+
+/// @brief Decodes a received result, and answers the request it carries. Once every task
+/// was sent, the worker is terminated with the others at the end
+static void complete_result(MasterState& state, MasterResult& result, const MPI_Status& status)
+{
+    const Settings& settings = *state.settings;
+
+    int message_size;
+    MPI_Get_count(&status, MPI_BYTE, &message_size);
+    if (!decode_result(result, message_size, state.image, state.assembled_field, state.field_tile, settings, state.raw_bytes)) {
+        LOG_ERROR("Malformed result of worker " << result.source);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    state.received_bytes += message_size;
+    log_completed(state, result);
+
+    ResultHeader header;
+    memcpy(&header, result.message.data(), sizeof(ResultHeader));
+    state.throughput[result.source].tasks += header.task_count;
+    state.throughput[result.source].seconds += header.render_seconds;
+
+    if (!state.counter && state.sent_task_count < state.num_tasks)
+        send_tasks(result.source, get_run_length(state, result.source, header.requested_tasks), state.num_tasks, state.sent_task_count);
+}
+
+/// @brief Handles a pending message of the workers, if any, and decodes the results that
+/// arrived. Returns whether there was anything to do
+static bool service_workers(MasterState& state)
+{
+    if (state.counter)
+        state.sent_task_count = std::min(state.num_tasks, state.counter->load());
+
+    MPI_Status status;
+    int has_message;
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &has_message, &status);
+    uint32_t source = status.MPI_SOURCE;
+
+    if (has_message && status.MPI_TAG == Tag::REQUEST) {
+        uint32_t requested_tasks;
+        MPI_Recv(&requested_tasks, 1, MPI_UINT32_T, source, Tag::REQUEST, MPI_COMM_WORLD, &status);
+        send_tasks(source, get_run_length(state, source, requested_tasks), state.num_tasks, state.sent_task_count);
+
+    } else if (has_message && status.MPI_TAG == Tag::RESULT) {
+        // Waits for a result to arrive when every buffer is receiving one
+        if (state.pending_results == MASTER_RESULT_BUFFERS) {
+            int index;
+            MPI_Status received_status;
+            MPI_Waitany(MASTER_RESULT_BUFFERS, state.receive_requests.data(), &index, &received_status);
+            --state.pending_results;
+            complete_result(state, state.results[index], received_status);
+        }
+
+        uint32_t slot = 0;
+        while (state.receive_requests[slot] != MPI_REQUEST_NULL)
+            ++slot;
+
+        // Messages of a source with the same tag arrive in order, so the receive matches
+        // the probed result, whose size is known from its status
+        int message_size;
+        MPI_Get_count(&status, MPI_BYTE, &message_size);
+
+        MasterResult& result = state.results[slot];
+        result.source = source;
+        result.message.resize(std::max<size_t>(result.message.size(), message_size));
+        MPI_Irecv(result.message.data(), message_size, MPI_BYTE, source, Tag::RESULT, MPI_COMM_WORLD, &state.receive_requests[slot]);
+        ++state.pending_results;
+    }
+
+    // Decodes the results that arrived
+    int received_count;
+    MPI_Testsome(MASTER_RESULT_BUFFERS, state.receive_requests.data(), &received_count, state.received_results.data(), state.receive_statuses.data());
+    for (int i = 0; i < received_count; ++i) {
+        --state.pending_results;
+        complete_result(state, state.results[state.received_results[i]], state.receive_statuses[i]);
+    }
+
+    check_all_sent(state);
+    return has_message || received_count > 0;
+}
+
+/// @brief Blocks until a result being received arrives, or until a worker sends a message
+/// when no result is being received, so a master with nothing to render doesn't poll
+static void wait_for_workers(MasterState& state)
+{
+    MPI_Status status;
+    if (state.pending_results == 0) {
+        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+        return;
+    }
+
+    int index;
+    MPI_Waitany(MASTER_RESULT_BUFFERS, state.receive_requests.data(), &index, &status);
+    --state.pending_results;
+    complete_result(state, state.results[index], status);
+}
+
+static void render_master_task(uint32_t task, uint32_t thread, void* data)
+{
+    MasterState& state = *(MasterState*)data;
+    const Settings& settings = *state.settings;
+
+    auto block = get_task_by_id(
+        state.schedule->get_task_id(state.rendered.first_task_id + task),
+        settings.block_size,
+        settings.image.width,
+        settings.image.height,
+        *state.symmetry);
+
+    std::chrono::time_point start = std::chrono::high_resolution_clock::now();
+    if (state.output_field) {
+        uint32_t block_field_size = settings.block_size * settings.block_size * settings.image.multi_sample_anti_aliasing;
+        render_block_field(
+            &state.rendered.field[(size_t)block_field_size * task],
+            settings.image,
+            settings.fractal,
+            settings.camera,
+            block.x,
+            block.y,
+            block.width,
+            block.height,
+            state.reference_orbit);
+    } else {
+        uint32_t block_buffer_size = settings.block_size * settings.block_size * 3;
+        render_block(
+            &state.rendered.buffer[(size_t)block_buffer_size * task],
+            settings.image,
+            settings.fractal,
+            settings.camera,
+            block.x,
+            block.y,
+            block.width,
+            block.height,
+            *state.palette,
+            state.reference_orbit);
+    }
+    std::chrono::duration<float> seconds = std::chrono::high_resolution_clock::now() - start;
+    state.rendered.seconds[task] = seconds.count();
+
+    // Only the main thread calls MPI, and it answers the workers between its tiles
+    if (thread == state.main_thread)
+        service_workers(state);
+}
 
 void master(
     uint32_t num_procs,
-    const Settings& settings)
+    const Settings& settings,
+    uint32_t threads,
+    const std::vector<uint32_t>& cpus,
+    const ReferenceOrbit* reference_orbit)
 {
     std::chrono::time_point start = std::chrono::high_resolution_clock::now();
 
-    uint8_t* image = new uint8_t[settings.image.width * settings.image.height * 3];
+    // Fields are written to the mapped file as the blocks arrive, instead of an image.
+    // Its tiles are the size of the blocks
+    const bool output_field = settings.output_settings.mode == OutputSettingsMode::FIELD;
+    const uint32_t samples_per_pixel = settings.image.multi_sample_anti_aliasing;
+    FieldFile field_file;
+    bool field_created = output_field
+        && field_file.create(
+            settings.output_settings.disk_data.output_path,
+            settings.image.width,
+            settings.image.height,
+            samples_per_pixel,
+            settings.block_size,
+            settings.fractal.max_iterations);
 
-    uint64_t num_tasks = get_num_tasks(settings.image.width, settings.image.height, settings.block_size);
-    uint32_t sent_task_count = 0;
-    uint32_t completed_task_count = 0;
-    uint32_t recv_buffer_size = settings.block_size * settings.block_size * 3;
-    uint8_t* recv_buffer = new uint8_t[recv_buffer_size];
+    uint8_t* image = output_field ? nullptr : new uint8_t[settings.image.width * settings.image.height * 3];
 
-    while (completed_task_count < num_tasks) {
-        MPI_Status status;
-        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-        uint32_t source = status.MPI_SOURCE;
-
-        if (status.MPI_TAG == Tag::REQUEST) {
-            MPI_Recv(NULL, 0, MPI_BYTE, source, Tag::REQUEST, MPI_COMM_WORLD, &status);
-            if (sent_task_count < num_tasks) {
-                // Sends task to worker
-                uint64_t task_id = sent_task_count++;
-                MPI_Send(&task_id, 1, MPI_INT64_T, source, Tag::TASK, MPI_COMM_WORLD);
-            } else {
-                MPI_Send(NULL, 0, MPI_BYTE, source, Tag::TERMINATE, MPI_COMM_WORLD);
-            }
+    ImageSymmetry symmetry = get_image_symmetry(settings.image, settings.fractal, settings.camera, settings.block_size);
+    uint64_t num_tasks = get_num_tasks(settings.image.width, settings.image.height, settings.block_size, symmetry);
+    TaskSchedule schedule;
+    if (symmetry.num_skipped_tasks() > 0)
+        LOG_STATUS("Mirroring " << symmetry.num_skipped_tasks() << " symmetric blocks, " << num_tasks << " scheduled");
 
-        } else if (status.MPI_TAG == Tag::RESULT) {
-            // Receives worker task id
-            uint64_t task_id;
-            MPI_Recv(&task_id, 1, MPI_INT64_T, source, Tag::RESULT, MPI_COMM_WORLD, &status);
-            WorkerTask result = get_task_by_id(
-                task_id,
-                settings.block_size,
-                settings.image.width,
-                settings.image.height);
-
-            // Receives subimage buffer
-            MPI_Recv(recv_buffer, recv_buffer_size, MPI_BYTE, source, Tag::RESULT, MPI_COMM_WORLD, &status);
-
-            // Copies subimage buffer into main image buffer
-            for (uint32_t j = 0; j < result.height; ++j) {
-                uint32_t dest_index = 3 * ((result.y + j) * settings.image.width + result.x);
-                uint8_t* dest_ptr = &image[dest_index];
-                uint8_t* src_ptr = &recv_buffer[j * result.width * 3];
-                memcpy(dest_ptr, src_ptr, result.width * sizeof(uint8_t) * 3);
-            }
-            ++completed_task_count;
-            LOG_STATUS("Worker " << source << " completed task. " << 100.0 * (float)completed_task_count / num_tasks << "%");
+    // Workers render every block, even when the field file couldn't be created
+    MasterState state;
+    state.settings = &settings;
+    state.symmetry = &symmetry;
+    state.schedule = &schedule;
+    state.num_tasks = num_tasks;
+    state.sent_task_count = 0;
+    state.completed_task_count = 0;
+    state.output_field = output_field;
+    state.image = image;
+    state.assembled_field = field_created ? &field_file : nullptr;
+    state.results.resize(MASTER_RESULT_BUFFERS);
+    state.receive_requests.assign(MASTER_RESULT_BUFFERS, MPI_REQUEST_NULL);
+    state.receive_statuses.resize(MASTER_RESULT_BUFFERS);
+    state.received_results.resize(MASTER_RESULT_BUFFERS);
+    state.pending_results = 0;
+    state.received_bytes = 0;
+    state.raw_bytes = 0;
+    state.all_sent = false;
+    state.throughput.resize(num_procs);
+
+    // The master renders runs of tasks like a worker whenever no worker needs it, unless
+    // it's disabled. Without workers, it renders the whole image
+    ThreadPool pool(threads);
+    uint32_t tasks_per_run = 1;
+    if (threads > 1) {
+        tasks_per_run = threads * HYBRID_TASKS_PER_THREAD;
+        if (!pool.pin_threads(cpus))
+            LOG_WARNING("Master couldn't pin its threads");
+    }
+
+    // Every rank waits for the order of the tasks, which the master estimates with its
+    // threads before dispatching any
+    if (settings.cost_order) {
+        std::chrono::time_point estimate_start = std::chrono::high_resolution_clock::now();
+        state.estimated_costs = estimate_task_costs(pool, settings, symmetry, num_tasks, reference_orbit);
+        state.actual_costs.resize(num_tasks);
+        sort_tasks_by_cost(schedule, state.estimated_costs);
+        broadcast_task_schedule(schedule, num_tasks);
+
+        auto estimate_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - estimate_start);
+        LOG_STATUS("Estimated the cost of " << num_tasks << " tasks in " << estimate_duration.count() << " ms");
+    }
+
+    // The counter is created by every rank, after the order of the tasks
+    TaskCounter counter;
+    state.counter = nullptr;
+    if (settings.rma_counter) {
+        counter.create();
+        state.counter = &counter;
+    }
+
+    Palette palette(settings.fractal);
+    state.rendered.source = 0;
+    state.palette = &palette;
+    state.reference_orbit = reference_orbit;
+    state.main_thread = pool.get_thread_count() - 1;
+    bool master_renders = settings.master_renders || num_procs == 1;
+    state.first_rendering_rank = master_renders ? 0 : 1;
+
+    while (state.completed_task_count < num_tasks) {
+        if (service_workers(state))
+            continue;
+
+        if (!master_renders || state.sent_task_count == num_tasks) {
+            wait_for_workers(state);
+            continue;
         }
+
+        // Claims the next run of tasks, like a request of a worker, or from the counter
+        // like the workers do
+        uint64_t run_length = get_run_length(state, 0, tasks_per_run);
+        state.rendered.first_task_id = state.counter ? state.counter->fetch_add(run_length) : state.sent_task_count;
+        uint64_t run_end = std::min(num_tasks, state.rendered.first_task_id + run_length);
+        state.sent_task_count = std::max(state.sent_task_count, run_end);
+        check_all_sent(state);
+        if (state.rendered.first_task_id >= num_tasks)
+            continue;
+        state.rendered.task_count = run_end - state.rendered.first_task_id;
+
+        // Buffers grow to the longest run
+        size_t block_size = (size_t)settings.block_size * settings.block_size;
+        if (state.rendered.seconds.size() < state.rendered.task_count) {
+            if (output_field)
+                state.rendered.field.resize(block_size * samples_per_pixel * state.rendered.task_count);
+            else
+                state.rendered.buffer.resize(block_size * 3 * state.rendered.task_count);
+            state.rendered.seconds.resize(state.rendered.task_count);
+        }
+
+        std::chrono::time_point run_start = std::chrono::high_resolution_clock::now();
+        pool.run(state.rendered.task_count, render_master_task, &state);
+        std::chrono::duration<double> run_seconds = std::chrono::high_resolution_clock::now() - run_start;
+        state.throughput[0].tasks += state.rendered.task_count;
+        state.throughput[0].seconds += run_seconds.count();
+
+        assemble_result(state.rendered, image, state.assembled_field, settings, symmetry, schedule);
+        log_completed(state, state.rendered);
     }
 
-    // Sends termination tag to all workers
-    for (uint32_t i = 1; i < num_procs; ++i) {
-        MPI_Send(NULL, 0, MPI_BYTE, i, Tag::TERMINATE, MPI_COMM_WORLD);
+    if (field_created)
+        mirror_skipped_field(field_file, symmetry, settings.block_size, settings.image.width, settings.image.height, sqrt(samples_per_pixel));
+    else if (!output_field)
+        mirror_skipped_blocks(image, symmetry, settings.block_size, settings.image.width, settings.image.height);
+
+    // Sends termination tag to all workers. Workers that claim tasks stop once none are
+    // left, and free the counter with the master
+    if (settings.rma_counter) {
+        counter.free();
+    } else {
+        for (uint32_t i = 1; i < num_procs; ++i) {
+            MPI_Send(NULL, 0, MPI_BYTE, i, Tag::TERMINATE, MPI_COMM_WORLD);
+        }
     }
 
     std::chrono::time_point end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     LOG_STATUS("Image generated in " << duration.count() << " ms");
 
+    // Time after the last task was sent, where ranks that finish have nothing left to do
+    if (state.all_sent && duration.count() > 0) {
+        auto tail = std::chrono::duration_cast<std::chrono::milliseconds>(end - state.all_sent_time);
+        LOG_STATUS("Every task was sent " << tail.count() << " ms before the end, " << 100.0 * tail.count() / duration.count() << "% of the time");
+    }
+    if (!state.estimated_costs.empty())
+        log_cost_report(state.estimated_costs, state.actual_costs);
+
+    if (settings.guided) {
+        for (uint32_t rank = state.first_rendering_rank; rank < num_procs; ++rank) {
+            const RankThroughput& rank_throughput = state.throughput[rank];
+            if (rank_throughput.seconds > 0.0)
+                LOG_STATUS("Rank " << rank << " rendered " << rank_throughput.tasks << " tasks at " << rank_throughput.tasks / rank_throughput.seconds << " tasks/s");
+        }
+    }
+    if (state.raw_bytes > 0)
+        LOG_STATUS("Results compressed to " << 100.0 * state.received_bytes / state.raw_bytes << "% of " << state.raw_bytes << " bytes");
+
+    if (output_field) {
+        if (!field_created) {
+            LOG_ERROR("Unable to output field...");
+        } else {
+            LOG_SUCCESS("Field outputted");
+        }
+        return;
+    }
+
     // Creates output handler based on the settings mode
     std::shared_ptr<OutputHandler> output_handler = OutputHandler::factory_create(settings.output_settings.mode);
 
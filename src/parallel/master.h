@@ -1,4 +1,14 @@
 #pragma once
+#include <stdint.h>
+#include <vector>
 #include "common/settings/settings.h"
+#include "common/perturbation.h"
 
-void master(uint32_t num_procs, const Settings& settings);
\ No newline at end of file
+/// @brief Dispatches the tasks to the workers and assembles their results. Unless disabled
+/// in the settings, the master renders tasks with its threads whenever no worker needs it
+void master(
+    uint32_t num_procs,
+    const Settings& settings,
+    uint32_t threads,
+    const std::vector<uint32_t>& cpus,
+    const ReferenceOrbit* reference_orbit);
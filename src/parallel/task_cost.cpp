@@ -0,0 +1,176 @@
+#include "task_cost.h"
+#include <mpi/mpi.h>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include "common/renderer.h"
+#include "common/logging.h"
+
+/// @brief Low resolution image shared by the threads that probe the blocks. Block b of
+/// the image maps to the pixels [b * probe_size, (b + 1) * probe_size) of the probe
+struct CostProbe {
+    const Settings* settings;
+    const ImageSymmetry* symmetry;
+    ImageSettings probe_image;
+    uint32_t probe_size;
+    bool output_field;
+    const Palette* palette;
+    const ReferenceOrbit* reference_orbit;
+    float* costs;
+    std::vector<std::vector<uint8_t>> thread_buffers;
+    std::vector<std::vector<float>> thread_fields;
+};
+
+static uint32_t to_probe_pixel(uint32_t pixel, const CostProbe& probe, uint32_t probe_extent)
+{
+    uint64_t probe_pixel = ((uint64_t)pixel * probe.probe_size + probe.settings->block_size - 1) / probe.settings->block_size;
+    return std::min<uint64_t>(probe_pixel, probe_extent);
+}
+
+static void probe_task(uint32_t task, uint32_t thread, void* data)
+{
+    CostProbe& probe = *(CostProbe*)data;
+    const Settings& settings = *probe.settings;
+
+    auto block = get_task_by_id(task, settings.block_size, settings.image.width, settings.image.height, *probe.symmetry);
+
+    // Blocks start at a multiple of the block size, so probes don't overlap
+    uint32_t x = to_probe_pixel(block.x, probe, probe.probe_image.width);
+    uint32_t y = to_probe_pixel(block.y, probe, probe.probe_image.height);
+    uint32_t width = std::max(to_probe_pixel(block.x + block.width, probe, probe.probe_image.width), x + 1) - x;
+    uint32_t height = std::max(to_probe_pixel(block.y + block.height, probe, probe.probe_image.height), y + 1) - y;
+
+    std::chrono::time_point start = std::chrono::high_resolution_clock::now();
+
+    if (probe.output_field) {
+        std::vector<float>& field = probe.thread_fields[thread];
+        field.resize((size_t)probe.probe_size * probe.probe_size);
+        render_block_field(field.data(), probe.probe_image, settings.fractal, settings.camera, x, y, width, height, probe.reference_orbit);
+    } else {
+        std::vector<uint8_t>& buffer = probe.thread_buffers[thread];
+        buffer.resize((size_t)probe.probe_size * probe.probe_size * 3);
+        render_block(buffer.data(), probe.probe_image, settings.fractal, settings.camera, x, y, width, height, *probe.palette, probe.reference_orbit);
+    }
+
+    std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - start;
+    double block_samples = (double)block.width * block.height * settings.image.multi_sample_anti_aliasing;
+    probe.costs[task] = seconds.count() * block_samples / ((double)width * height);
+}
+
+std::vector<float> estimate_task_costs(
+    ThreadPool& pool,
+    const Settings& settings,
+    const ImageSymmetry& symmetry,
+    uint64_t num_tasks,
+    const ReferenceOrbit* reference_orbit)
+{
+    std::vector<float> costs(num_tasks);
+    uint32_t probe_size = std::min<uint32_t>(COST_PROBE_SIZE, settings.block_size);
+
+    // A single sample per pixel, without refinement, at the scale of the probes
+    ImageSettings probe_image = settings.image;
+    probe_image.width = std::max<uint64_t>(1, ((uint64_t)settings.image.width * probe_size + settings.block_size - 1) / settings.block_size);
+    probe_image.height = std::max<uint64_t>(1, ((uint64_t)settings.image.height * probe_size + settings.block_size - 1) / settings.block_size);
+    probe_image.multi_sample_anti_aliasing = 1;
+    probe_image.adaptive_samples = 0;
+
+    Palette palette(settings.fractal);
+    uint32_t threads = pool.get_thread_count();
+    CostProbe probe = { &settings, &symmetry, probe_image, probe_size, settings.output_settings.mode == OutputSettingsMode::FIELD, &palette, reference_orbit, costs.data(), std::vector<std::vector<uint8_t>>(threads), std::vector<std::vector<float>>(threads) };
+
+    pool.run(num_tasks, probe_task, &probe);
+    return costs;
+}
+
+/// @brief Orders task ids by descending cost
+struct DescendingCost {
+    const std::vector<float>* costs;
+
+    bool operator()(uint64_t a, uint64_t b) const
+    {
+        return (*costs)[a] > (*costs)[b];
+    }
+};
+
+void sort_tasks_by_cost(TaskSchedule& schedule, const std::vector<float>& costs)
+{
+    schedule.task_ids.resize(costs.size());
+    for (uint64_t task = 0; task < costs.size(); ++task)
+        schedule.task_ids[task] = task;
+
+    // Ties keep the raster order, so uniform regions are still dispatched in runs
+    DescendingCost descending = { &costs };
+    std::stable_sort(schedule.task_ids.begin(), schedule.task_ids.end(), descending);
+}
+
+void broadcast_task_schedule(TaskSchedule& schedule, uint64_t num_tasks)
+{
+    schedule.task_ids.resize(num_tasks);
+    MPI_Bcast(schedule.task_ids.data(), num_tasks, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+}
+
+/// @brief Rank of each value, where equal values share the mean of their ranks
+static std::vector<double> get_ranks(const std::vector<float>& values)
+{
+    std::vector<uint64_t> order(values.size());
+    for (uint64_t i = 0; i < values.size(); ++i)
+        order[i] = i;
+
+    DescendingCost descending = { &values };
+    std::sort(order.begin(), order.end(), descending);
+
+    std::vector<double> ranks(values.size());
+    for (uint64_t begin = 0; begin < order.size();) {
+        uint64_t end = begin + 1;
+        while (end < order.size() && values[order[end]] == values[order[begin]])
+            ++end;
+
+        for (uint64_t i = begin; i < end; ++i)
+            ranks[order[i]] = 0.5 * (begin + end - 1);
+        begin = end;
+    }
+    return ranks;
+}
+
+void log_cost_report(const std::vector<float>& estimated_costs, const std::vector<float>& actual_costs)
+{
+    uint64_t count = estimated_costs.size();
+    if (count < 2)
+        return;
+
+    // Spearman's correlation is the Pearson correlation of the ranks. It's 1 when the
+    // estimate dispatches the tasks exactly from the slowest to the fastest
+    std::vector<double> estimated_ranks = get_ranks(estimated_costs);
+    std::vector<double> actual_ranks = get_ranks(actual_costs);
+    double mean_rank = 0.5 * (count - 1);
+    double covariance = 0.0, estimated_variance = 0.0, actual_variance = 0.0;
+    double estimated_total = 0.0, actual_total = 0.0;
+
+    for (uint64_t task = 0; task < count; ++task) {
+        double estimated = estimated_ranks[task] - mean_rank;
+        double actual = actual_ranks[task] - mean_rank;
+        covariance += estimated * actual;
+        estimated_variance += estimated * estimated;
+        actual_variance += actual * actual;
+        estimated_total += estimated_costs[task];
+        actual_total += actual_costs[task];
+    }
+
+    double correlation = estimated_variance > 0.0 && actual_variance > 0.0 ? covariance / sqrt(estimated_variance * actual_variance) : 0.0;
+
+    // Share of the render time in the tasks estimated to be the slowest tenth
+    uint64_t top_count = std::max<uint64_t>(1, count / 10);
+    std::vector<uint64_t> by_estimate(count);
+    for (uint64_t task = 0; task < count; ++task)
+        by_estimate[task] = task;
+    DescendingCost descending = { &estimated_costs };
+    std::partial_sort(by_estimate.begin(), by_estimate.begin() + top_count, by_estimate.end(), descending);
+
+    double top_actual = 0.0;
+    for (uint64_t i = 0; i < top_count; ++i)
+        top_actual += actual_costs[by_estimate[i]];
+
+    LOG_STATUS("Cost estimate: predicted " << estimated_total * 1000.0 << " ms of rendering, took " << actual_total * 1000.0 << " ms");
+    LOG_STATUS("Cost estimate: rank correlation " << correlation << " with the render times. The slowest tenth of the estimate took "
+                                                  << (actual_total > 0.0 ? 100.0 * top_actual / actual_total : 0.0) << "% of the time");
+}
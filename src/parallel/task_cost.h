@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "worker_task.h"
+#include "common/settings/settings.h"
+#include "common/perturbation.h"
+#include "common/thread_pool.h"
+
+/// @brief Pixels per side of the low resolution probe of a block that estimates its cost
+#ifndef COST_PROBE_SIZE
+#define COST_PROBE_SIZE 8
+#endif
+
+/// @brief Estimates the seconds each task takes to render, indexed by task id. Every block
+/// is rendered at COST_PROBE_SIZE pixels per side and a single sample, and the time it
+/// took is scaled to the samples of the block
+std::vector<float> estimate_task_costs(
+    ThreadPool& pool,
+    const Settings& settings,
+    const ImageSymmetry& symmetry,
+    uint64_t num_tasks,
+    const ReferenceOrbit* reference_orbit);
+
+/// @brief Orders the tasks from the most to the least costly, so that the slowest blocks
+/// start first and the last ones to finish are short (longest processing time first)
+void sort_tasks_by_cost(TaskSchedule& schedule, const std::vector<float>& costs);
+
+/// @brief Sends the order of the tasks of the master to every worker. Collective
+void broadcast_task_schedule(TaskSchedule& schedule, uint64_t num_tasks);
+
+/// @brief Logs how the estimated costs compare with the render times of the tasks
+void log_cost_report(const std::vector<float>& estimated_costs, const std::vector<float>& actual_costs);
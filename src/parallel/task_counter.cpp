@@ -0,0 +1,41 @@
+#include "task_counter.h"
+
+void TaskCounter::create()
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    MPI_Aint size = rank == 0 ? sizeof(uint64_t) : 0;
+    MPI_Win_allocate(size, sizeof(uint64_t), MPI_INFO_NULL, MPI_COMM_WORLD, &counter, &window);
+
+    // Every rank keeps a passive target epoch open, so claims don't synchronize with the
+    // master. The counter is initialized before any rank accesses it
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+    if (rank == 0) {
+        *counter = 0;
+        MPI_Win_sync(window);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void TaskCounter::free()
+{
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+}
+
+uint64_t TaskCounter::fetch_add(uint64_t count)
+{
+    uint64_t previous;
+    MPI_Fetch_and_op(&count, &previous, MPI_UINT64_T, 0, 0, MPI_SUM, window);
+    MPI_Win_flush(0, window);
+    return previous;
+}
+
+uint64_t TaskCounter::load()
+{
+    uint64_t value;
+    MPI_Fetch_and_op(nullptr, &value, MPI_UINT64_T, 0, 0, MPI_NO_OP, window);
+    MPI_Win_flush(0, window);
+    return value;
+}
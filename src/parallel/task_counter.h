@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <mpi/mpi.h>
+
+/// @brief Position of the next task to dispatch, held in an MPI window of rank 0. Ranks
+/// claim runs of tasks by adding to it with an atomic fetch and add, which completes
+/// without a message to the master or its CPU, when the network supports it
+class TaskCounter {
+public:
+    /// @brief Creates the window of the counter, starting at 0. Collective
+    void create();
+
+    /// @brief Frees the window, once no rank claims tasks. Collective
+    void free();
+
+    /// @brief Adds count to the counter, and returns the position before the addition.
+    /// Positions past the tasks mean they were all claimed
+    uint64_t fetch_add(uint64_t count);
+
+    /// @brief Position of the next task to dispatch
+    uint64_t load();
+
+private:
+    MPI_Win window;
+    uint64_t* counter;
+};
@@ -0,0 +1,329 @@
+#include "tile_codec.h"
+#include <string.h>
+#include <algorithm>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+
+/// @brief Rows of the destination of a tile, addressed as the bytes of the decoded tile
+struct TileRows {
+    uint8_t* rows;
+    uint32_t row_size;
+    size_t stride;
+    uint64_t size;
+    uint64_t written;
+
+    uint8_t* at(uint64_t position) const
+    {
+        return rows + position / row_size * stride + position % row_size;
+    }
+
+    /// @brief Copies size bytes from source, which are never more than the bytes left
+    void write(const uint8_t* source, uint64_t size)
+    {
+        while (size > 0) {
+            uint64_t chunk = std::min<uint64_t>(size, row_size - written % row_size);
+            memcpy(at(written), source, chunk);
+            source += chunk;
+            size -= chunk;
+            written += chunk;
+        }
+    }
+
+    /// @brief Copies size bytes from offset bytes back. Chunks are never longer than the
+    /// offset, so that a repeated pattern is copied as it's written
+    void copy(uint64_t offset, uint64_t size)
+    {
+        while (size > 0) {
+            uint64_t source = written - offset;
+            uint64_t chunk = std::min<uint64_t>({ size, offset, row_size - written % row_size, row_size - source % row_size });
+            memcpy(at(written), at(source), chunk);
+            size -= chunk;
+            written += chunk;
+        }
+    }
+};
+
+// RLE ---------------------------------------------------------------------------------------
+// Each run starts with a control byte. Below 128, it's followed by control + 1 literal
+// pixels. From 128, it's followed by a single pixel repeated control - 126 times
+
+static uint32_t encode_rle(const uint8_t* pixels, uint32_t size, uint32_t pixel_size, uint8_t* encoded, uint32_t capacity)
+{
+    uint32_t count = size / pixel_size;
+    uint32_t out = 0;
+    uint32_t i = 0;
+
+    while (i < count) {
+        const uint8_t* pixel = pixels + (uint64_t)i * pixel_size;
+        uint32_t run = 1;
+        while (i + run < count && run < 129 && !memcmp(pixel, pixel + (uint64_t)run * pixel_size, pixel_size))
+            ++run;
+
+        if (run >= 2) {
+            if (out + 1 + pixel_size > capacity)
+                return 0;
+
+            encoded[out++] = 126 + run;
+            memcpy(encoded + out, pixel, pixel_size);
+            out += pixel_size;
+            i += run;
+            continue;
+        }
+
+        // Literals go on until a pixel starts a repeated run
+        uint32_t literals = 1;
+        while (i + literals < count && literals < 128) {
+            const uint8_t* next = pixels + (uint64_t)(i + literals) * pixel_size;
+            if (i + literals + 1 < count && !memcmp(next, next + pixel_size, pixel_size))
+                break;
+            ++literals;
+        }
+
+        if (out + 1 + literals * pixel_size > capacity)
+            return 0;
+
+        encoded[out++] = literals - 1;
+        memcpy(encoded + out, pixel, (size_t)literals * pixel_size);
+        out += literals * pixel_size;
+        i += literals;
+    }
+    return out;
+}
+
+static bool decode_rle(const uint8_t* encoded, uint32_t encoded_size, uint32_t pixel_size, TileRows& rows)
+{
+    uint32_t in = 0;
+    while (in < encoded_size) {
+        uint32_t control = encoded[in++];
+
+        if (control < 128) {
+            uint64_t literal_size = (uint64_t)(control + 1) * pixel_size;
+            if (in + literal_size > encoded_size || rows.written + literal_size > rows.size)
+                return false;
+
+            rows.write(encoded + in, literal_size);
+            in += literal_size;
+            continue;
+        }
+
+        uint32_t run = control - 126;
+        if (in + pixel_size > encoded_size || rows.written + (uint64_t)run * pixel_size > rows.size)
+            return false;
+
+        // Pixels never cross rows, since rows hold whole pixels
+        for (uint32_t i = 0; i < run; ++i)
+            rows.write(encoded + in, pixel_size);
+        in += pixel_size;
+    }
+    return rows.written == rows.size;
+}
+
+// LZ ----------------------------------------------------------------------------------------
+// A sequence of literals and a match. The token holds the literal count in its high nibble
+// and the match length minus LZ_MIN_MATCH in its low nibble, where 15 continues in bytes
+// that are added until one is below 255. The literals follow, then the offset of the match
+// in 2 little endian bytes and the rest of its length. The last sequence has no match
+
+static inline uint32_t read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t lz_hash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/// @brief Writes the part of a length above the nibble, or returns false without room
+static bool write_length(uint32_t length, uint8_t* encoded, uint32_t& out, uint32_t capacity)
+{
+    for (length -= 15; length >= 255; length -= 255) {
+        if (out >= capacity)
+            return false;
+        encoded[out++] = 255;
+    }
+
+    if (out >= capacity)
+        return false;
+    encoded[out++] = length;
+    return true;
+}
+
+static bool read_length(uint32_t& length, const uint8_t* encoded, uint32_t& in, uint32_t encoded_size)
+{
+    uint8_t byte;
+    do {
+        if (in >= encoded_size)
+            return false;
+        byte = encoded[in++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+static bool write_sequence(
+    const uint8_t* literals,
+    uint32_t literal_count,
+    uint32_t offset,
+    uint32_t match_length,
+    uint8_t* encoded,
+    uint32_t& out,
+    uint32_t capacity)
+{
+    if (out >= capacity)
+        return false;
+
+    uint32_t match_code = match_length > 0 ? match_length - LZ_MIN_MATCH : 0;
+    encoded[out++] = (std::min(literal_count, 15u) << 4) | std::min(match_code, 15u);
+
+    if (literal_count >= 15 && !write_length(literal_count, encoded, out, capacity))
+        return false;
+
+    if (out + literal_count > capacity)
+        return false;
+    memcpy(encoded + out, literals, literal_count);
+    out += literal_count;
+
+    if (match_length == 0)
+        return true;
+
+    if (out + 2 > capacity)
+        return false;
+    encoded[out++] = offset & 0xFF;
+    encoded[out++] = offset >> 8;
+
+    return match_code < 15 || write_length(match_code, encoded, out, capacity);
+}
+
+static uint32_t encode_lz(const uint8_t* data, uint32_t size, uint8_t* encoded, uint32_t capacity)
+{
+    // Positions plus one of the last bytes with each hash, 0 when there's none
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    uint32_t out = 0;
+    uint32_t anchor = 0;
+    uint32_t i = 0;
+
+    while (i + LZ_MIN_MATCH <= size) {
+        uint32_t value = read32(data + i);
+        uint32_t& entry = table[lz_hash(value)];
+        uint32_t candidate = entry;
+        entry = i + 1;
+
+        if (candidate == 0 || i + 1 - candidate > LZ_MAX_OFFSET || read32(data + candidate - 1) != value) {
+            ++i;
+            continue;
+        }
+
+        uint32_t match = candidate - 1;
+        uint32_t length = LZ_MIN_MATCH;
+        while (i + length < size && data[match + length] == data[i + length])
+            ++length;
+
+        if (!write_sequence(data + anchor, i - anchor, i - match, length, encoded, out, capacity))
+            return 0;
+
+        i += length;
+        anchor = i;
+    }
+
+    if (!write_sequence(data + anchor, size - anchor, 0, 0, encoded, out, capacity))
+        return 0;
+    return out;
+}
+
+static bool decode_lz(const uint8_t* encoded, uint32_t encoded_size, TileRows& rows)
+{
+    uint32_t in = 0;
+    while (in < encoded_size) {
+        uint8_t token = encoded[in++];
+
+        uint32_t literal_count = token >> 4;
+        if (literal_count == 15 && !read_length(literal_count, encoded, in, encoded_size))
+            return false;
+
+        if (in + literal_count > encoded_size || rows.written + literal_count > rows.size)
+            return false;
+        rows.write(encoded + in, literal_count);
+        in += literal_count;
+
+        // The last sequence ends with its literals
+        if (in == encoded_size)
+            break;
+
+        if (in + 2 > encoded_size)
+            return false;
+        uint32_t offset = encoded[in] | (encoded[in + 1] << 8);
+        in += 2;
+
+        uint32_t match_length = token & 15;
+        if (match_length == 15 && !read_length(match_length, encoded, in, encoded_size))
+            return false;
+        match_length += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > rows.written || rows.written + match_length > rows.size)
+            return false;
+        rows.copy(offset, match_length);
+    }
+    return rows.written == rows.size;
+}
+
+uint32_t encode_tile(
+    const uint8_t* pixels,
+    uint32_t size,
+    uint32_t pixel_size,
+    uint8_t* encoded,
+    uint8_t* scratch,
+    TileCodec& codec)
+{
+    // LZ is only kept when it beats the runs, which are cheaper to decode. It finds the
+    // repeated patterns of the cyclic color modes and of the rows of smooth gradients
+    uint32_t rle_size = encode_rle(pixels, size, pixel_size, encoded, size);
+    uint32_t lz_size = encode_lz(pixels, size, scratch, rle_size > 0 ? rle_size - 1 : size);
+
+    if (lz_size > 0) {
+        memcpy(encoded, scratch, lz_size);
+        codec = TileCodec::LZ;
+        return lz_size;
+    }
+
+    if (rle_size > 0) {
+        codec = TileCodec::RLE;
+        return rle_size;
+    }
+
+    memcpy(encoded, pixels, size);
+    codec = TileCodec::RAW;
+    return size;
+}
+
+bool decode_tile(
+    TileCodec codec,
+    const uint8_t* encoded,
+    uint32_t encoded_size,
+    uint32_t pixel_size,
+    uint8_t* rows,
+    uint32_t row_size,
+    uint32_t row_count,
+    size_t stride)
+{
+    TileRows tile_rows = { rows, row_size, stride, (uint64_t)row_size * row_count, 0 };
+
+    switch (codec) {
+    case TileCodec::RAW:
+        if (encoded_size != tile_rows.size)
+            return false;
+        tile_rows.write(encoded, encoded_size);
+        return true;
+    case TileCodec::RLE:
+        return decode_rle(encoded, encoded_size, pixel_size, tile_rows);
+    case TileCodec::LZ:
+        return decode_lz(encoded, encoded_size, tile_rows);
+    }
+    return false;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/// @brief Encoding of the pixels of a tile in a result message
+enum class TileCodec : uint32_t {
+    RAW,
+
+    /// @brief Runs of repeated pixels, and runs of literal pixels
+    RLE,
+
+    /// @brief Byte oriented LZ77, with literal runs and back references of up to 64 KiB
+    LZ
+};
+
+/// @brief Start of a result message. It's followed by task_count tiles, each one a
+/// TileHeader and its encoded pixels
+struct ResultHeader {
+    uint64_t first_task_id;
+    uint32_t task_count;
+
+    /// @brief Tasks the worker requests in place of the ones of the result
+    uint32_t requested_tasks;
+
+    /// @brief Seconds the worker took to render the tasks, with all its threads
+    float render_seconds;
+};
+
+struct TileHeader {
+    uint32_t x, y, width, height;
+    TileCodec codec;
+
+    /// @brief Bytes of the encoded pixels that follow the header
+    uint32_t size;
+
+    /// @brief Seconds the tile took to render, compared with the estimated cost
+    float render_seconds;
+};
+
+/// @brief Encodes size bytes of pixels of pixel_size bytes each into encoded, with the
+/// codec that makes them smallest. encoded and scratch have room for size bytes, and a
+/// tile that doesn't compress is copied raw. Returns the encoded size
+uint32_t encode_tile(
+    const uint8_t* pixels,
+    uint32_t size,
+    uint32_t pixel_size,
+    uint8_t* encoded,
+    uint8_t* scratch,
+    TileCodec& codec);
+
+/// @brief Decodes a tile into rows of row_size bytes that start stride bytes apart, so
+/// that tiles are decoded straight into the image. Returns false when the encoded pixels
+/// don't fill the rows exactly
+bool decode_tile(
+    TileCodec codec,
+    const uint8_t* encoded,
+    uint32_t encoded_size,
+    uint32_t pixel_size,
+    uint8_t* rows,
+    uint32_t row_size,
+    uint32_t row_count,
+    size_t stride);
@@ -2,62 +2,289 @@
 #include <mpi/mpi.h>
 #include <cstdint>
 #include <cmath>
+#include <algorithm>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <memory>
 #include "worker.h"
+#include "tile_codec.h"
+#include "task_cost.h"
+#include "task_counter.h"
 #include "common/renderer.h"
+#include "common/thread_pool.h"
+#include "common/logging.h"
+
+/// @brief Scratch of a thread, where its tiles render before they're encoded
+struct WorkerThreadTile {
+    std::vector<uint8_t> buffer;
+    std::vector<float> field;
+    std::vector<uint8_t> scratch;
+};
+
+/// @brief Tasks of a batch, rendered by the threads of the worker and encoded into
+/// consecutive slots of the result message, each one a TileHeader and room for a raw tile
+struct WorkerBatch {
+    uint64_t first_task_id;
+    uint32_t block_size;
+    const ImageSettings* image_settings;
+    const FractalSettings* fractal_settings;
+    const Camera* camera;
+    const ImageSymmetry* symmetry;
+    const TaskSchedule* schedule;
+    const Palette* palette;
+    const ReferenceOrbit* reference_orbit;
+    bool output_field;
+    uint8_t* message;
+    uint32_t pixel_size, slot_size;
+    std::vector<WorkerThreadTile> thread_tiles;
+
+    // Sends of the previous results, progressed by the main thread between its tasks
+    MPI_Request* send_requests;
+    uint32_t main_thread;
+};
+
+static void render_batch_task(uint32_t task, uint32_t thread, void* data)
+{
+    WorkerBatch& batch = *(WorkerBatch*)data;
+
+    auto block = get_task_by_id(
+        batch.schedule->get_task_id(batch.first_task_id + task),
+        batch.block_size,
+        batch.image_settings->width,
+        batch.image_settings->height,
+        *batch.symmetry);
+
+    // The first tile of a thread allocates its scratch, so the pages are touched first
+    // by the core that renders into them
+    WorkerThreadTile& tile = batch.thread_tiles[thread];
+    uint32_t raw_size = batch.slot_size - sizeof(TileHeader);
+    if (tile.scratch.empty())
+        tile.scratch.resize(raw_size);
+
+    std::chrono::time_point start = std::chrono::high_resolution_clock::now();
+    const uint8_t* pixels;
+    if (batch.output_field) {
+        if (tile.field.empty())
+            tile.field.resize(raw_size / sizeof(float));
+
+        render_block_field(
+            tile.field.data(),
+            *batch.image_settings,
+            *batch.fractal_settings,
+            *batch.camera,
+            block.x,
+            block.y,
+            block.width,
+            block.height,
+            batch.reference_orbit);
+        pixels = (const uint8_t*)tile.field.data();
+    } else {
+        if (tile.buffer.empty())
+            tile.buffer.resize(raw_size);
+
+        render_block(
+            tile.buffer.data(),
+            *batch.image_settings,
+            *batch.fractal_settings,
+            *batch.camera,
+            block.x,
+            block.y,
+            block.width,
+            block.height,
+            *batch.palette,
+            batch.reference_orbit);
+        pixels = tile.buffer.data();
+    }
+    std::chrono::duration<float> seconds = std::chrono::high_resolution_clock::now() - start;
+
+    // Encodes the tile into its slot of the message
+    uint8_t* slot = batch.message + sizeof(ResultHeader) + (uint64_t)task * batch.slot_size;
+    TileHeader header = { block.x, block.y, block.width, block.height, TileCodec::RAW, 0, seconds.count() };
+    header.size = encode_tile(
+        pixels,
+        block.width * block.height * batch.pixel_size,
+        batch.pixel_size,
+        slot + sizeof(TileHeader),
+        tile.scratch.data(),
+        header.codec);
+    memcpy(slot, &header, sizeof(TileHeader));
+
+    // Only the main thread calls MPI. Testing the sends lets large results, which wait
+    // for the master to post their receive, transfer while the tiles render
+    if (thread == batch.main_thread) {
+        int sent;
+        MPI_Testall(WORKER_RESULT_BUFFERS, batch.send_requests, &sent, MPI_STATUSES_IGNORE);
+    }
+}
+
+/// @brief Message of a result, grown to the largest run of tasks. It isn't initialized,
+/// so its pages are first touched by the threads that encode into it
+struct WorkerMessage {
+    std::unique_ptr<uint8_t[]> data;
+    uint64_t capacity = 0;
+
+    uint8_t* reserve(uint64_t size)
+    {
+        if (size > capacity) {
+            data.reset(new uint8_t[size]);
+            capacity = size;
+        }
+        return data.get();
+    }
+};
+
+/// @brief Moves the encoded tiles of the slots of a message after one another, and
+/// returns the size of the message
+static uint64_t compact_result(uint8_t* message, uint32_t task_count, uint32_t slot_size)
+{
+    uint64_t size = sizeof(ResultHeader);
+    for (uint32_t task = 0; task < task_count; ++task) {
+        const uint8_t* slot = message + sizeof(ResultHeader) + (uint64_t)task * slot_size;
+        TileHeader header;
+        memcpy(&header, slot, sizeof(TileHeader));
+
+        uint64_t tile_size = sizeof(TileHeader) + header.size;
+        memmove(message + size, slot, tile_size);
+        size += tile_size;
+    }
+    return size;
+}
+
+/// @brief Claims the next run of tasks from the counter of the master into task_range.
+/// Guided runs are an equal share of guided_ranks of the tasks that were left when the
+/// rank last claimed. Returns false once every task was claimed
+static bool claim_tasks(
+    TaskCounter& counter,
+    uint64_t num_tasks,
+    uint32_t tasks_per_request,
+    uint32_t guided_ranks,
+    uint64_t& last_position,
+    uint64_t task_range[2])
+{
+    uint64_t run_length = tasks_per_request;
+    if (guided_ranks > 0 && last_position < num_tasks)
+        run_length = std::max<uint64_t>(run_length, ceil((double)(num_tasks - last_position) / (GUIDED_CHUNK_DIVISOR * guided_ranks)));
+
+    task_range[0] = counter.fetch_add(run_length);
+    if (task_range[0] >= num_tasks)
+        return false;
+
+    task_range[1] = std::min<uint64_t>(run_length, num_tasks - task_range[0]);
+    last_position = task_range[0] + task_range[1];
+    return true;
+}
 
 void worker(
     uint32_t rank,
-    uint32_t block_size,
-    const ImageSettings& image_settings,
-    const Camera& camera,
-    const FractalSettings& fractal_settings)
+    uint32_t num_procs,
+    const Settings& settings,
+    uint32_t threads,
+    const std::vector<uint32_t>& cpus,
+    const ReferenceOrbit* reference_orbit)
 {
+    const ImageSettings& image_settings = settings.image;
+    const FractalSettings& fractal_settings = settings.fractal;
+    const Camera& camera = settings.camera;
+    const uint32_t block_size = settings.block_size;
+    const bool output_field = settings.output_settings.mode == OutputSettingsMode::FIELD;
+
+    // Threaded workers are pinned to their cores, and ask for several tasks per request,
+    // so that every thread has blocks to render and steal
+    ThreadPool pool(threads);
+    uint32_t tasks_per_request = 1;
+    if (threads > 1) {
+        tasks_per_request = threads * HYBRID_TASKS_PER_THREAD;
+        if (!pool.pin_threads(cpus))
+            LOG_WARNING("Worker " << rank << " couldn't pin its threads");
+    }
+
+    // Each result is a single message, with a slot per task that has room for a raw tile
+    uint32_t pixel_size = output_field ? image_settings.multi_sample_anti_aliasing * sizeof(float) : 3;
+    uint32_t slot_size = sizeof(TileHeader) + block_size * block_size * pixel_size;
+
+    // Results are sent from a ring of messages, so rendering goes on while they transfer
+    WorkerMessage messages[WORKER_RESULT_BUFFERS];
+    MPI_Request send_requests[WORKER_RESULT_BUFFERS];
+    for (uint32_t i = 0; i < WORKER_RESULT_BUFFERS; ++i)
+        send_requests[i] = MPI_REQUEST_NULL;
+    uint32_t next_result = 0;
+
+    // Colors are compiled once for every task
+    Palette palette(fractal_settings);
+
+    // Same symmetry as the master, so that task ids map to the same blocks
+    ImageSymmetry symmetry = get_image_symmetry(image_settings, fractal_settings, camera, block_size);
 
-    // Creates a buffer to store the partial image pixels
-    uint32_t buffer_len = block_size * block_size * 3;
-    uint8_t* buffer = new uint8_t[buffer_len];
+    // Receives the order of the tasks, which the master estimates before dispatching any
+    uint64_t num_tasks = get_num_tasks(image_settings.width, image_settings.height, block_size, symmetry);
+    TaskSchedule schedule;
+    if (settings.cost_order)
+        broadcast_task_schedule(schedule, num_tasks);
+
+    // Tasks are claimed from the counter of the master instead, without requests
+    TaskCounter counter;
+    uint64_t last_position = 0;
+    if (settings.rma_counter)
+        counter.create();
+
+    WorkerBatch batch = { 0, block_size, &image_settings, &fractal_settings, &camera, &symmetry, &schedule, &palette, reference_orbit, output_field, nullptr, pixel_size, slot_size, std::vector<WorkerThreadTile>(pool.get_thread_count()), send_requests, pool.get_thread_count() - 1 };
+
+    // Requests the task to render, plus the ones prefetched, which arrive while it's
+    // rendered. Requests carry the number of tasks wanted, which guided scheduling takes
+    // as the smallest run to send
+    if (!settings.rma_counter) {
+        for (uint32_t request = 0; request < 1 + settings.prefetch; ++request)
+            MPI_Send(&tasks_per_request, 1, MPI_UINT32_T, 0, Tag::REQUEST, MPI_COMM_WORLD);
+    }
 
     while (true) {
 
-        MPI_Status status;
-
-        // Sends task request to master
-        MPI_Send(NULL, 0, MPI_BYTE, 0, Tag::REQUEST, MPI_COMM_WORLD);
-
-        // Waits until a message with any tag is received
-        MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-
-        // When the tag is task, master sent task
-        if (status.MPI_TAG == Tag::TASK) {
-            uint64_t task_id;
-            MPI_Recv(&task_id, 1, MPI_INT64_T, 0, Tag::TASK, MPI_COMM_WORLD, &status);
-
-            auto task = get_task_by_id(
-                task_id,
-                block_size,
-                image_settings.width,
-                image_settings.height);
-
-            // Renders the block into buffer
-            render_block(
-                buffer,
-                image_settings,
-                fractal_settings,
-                camera,
-                task.x,
-                task.y,
-                task.width,
-                task.height);
-
-            // Sends task and buffer with contents
-            MPI_Send(&task_id, 1, MPI_INT64_T, 0, Tag::RESULT, MPI_COMM_WORLD);
-            MPI_Send(buffer, buffer_len, MPI_BYTE, 0, Tag::RESULT, MPI_COMM_WORLD);
-
-        } else if (status.MPI_TAG == Tag::TERMINATE) {
-            MPI_Recv(NULL, 0, MPI_BYTE, 0, Tag::TERMINATE, MPI_COMM_WORLD, &status);
-            break;
+        uint64_t task_range[2];
+        if (settings.rma_counter) {
+            if (!claim_tasks(counter, num_tasks, tasks_per_request, settings.guided ? num_procs : 0, last_position, task_range))
+                break;
+        } else {
+            MPI_Status status;
+
+            // Waits until a message with any tag is received. The master answers requests
+            // in order, so once it terminates, no task is left behind
+            MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+
+            if (status.MPI_TAG == Tag::TERMINATE) {
+                MPI_Recv(NULL, 0, MPI_BYTE, 0, Tag::TERMINATE, MPI_COMM_WORLD, &status);
+                break;
+            }
+
+            // When the tag is task, master sent the first id and count of consecutive tasks
+            MPI_Recv(task_range, 2, MPI_UINT64_T, 0, Tag::TASK, MPI_COMM_WORLD, &status);
         }
+
+        // The oldest message is reused once its send completes
+        uint32_t task_count = task_range[1];
+        MPI_Wait(&send_requests[next_result], MPI_STATUS_IGNORE);
+        uint8_t* message = messages[next_result].reserve(sizeof(ResultHeader) + (uint64_t)slot_size * task_count);
+
+        std::chrono::time_point start = std::chrono::high_resolution_clock::now();
+        batch.first_task_id = task_range[0];
+        batch.message = message;
+        pool.run(task_count, render_batch_task, &batch);
+        std::chrono::duration<float> seconds = std::chrono::high_resolution_clock::now() - start;
+
+        // Sends the encoded tiles, in the order of their ids. The result also requests
+        // the tasks that replace them, unless they're claimed from the counter, and the
+        // time they took measures the throughput
+        uint32_t requested_tasks = settings.rma_counter ? 0 : tasks_per_request;
+        ResultHeader header = { task_range[0], task_count, requested_tasks, seconds.count() };
+        memcpy(message, &header, sizeof(ResultHeader));
+        uint64_t size = compact_result(message, task_count, slot_size);
+        MPI_Isend(message, size, MPI_BYTE, 0, Tag::RESULT, MPI_COMM_WORLD, &send_requests[next_result]);
+        next_result = (next_result + 1) % WORKER_RESULT_BUFFERS;
     }
 
-    delete buffer;
+    // Workers terminated before the end wait for the master to receive their last results
+    MPI_Waitall(WORKER_RESULT_BUFFERS, send_requests, MPI_STATUSES_IGNORE);
+
+    if (settings.rma_counter)
+        counter.free();
 }
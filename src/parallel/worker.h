@@ -1,11 +1,18 @@
 #pragma once
 #include <stdint.h>
+#include <vector>
 #include "common/settings/settings.h"
 #include "common/fractal.h"
+#include "common/perturbation.h"
 
+/// @brief Renders the tasks sent by the master until it terminates the worker, or with
+/// the RMA counter of the settings, the tasks it claims until none are left
+/// @param threads Threads that render the tasks. With more than one, the worker asks
+/// for several tasks per request and pins its threads to cpus
 void worker(
     uint32_t rank,
-    uint32_t block_size,
-    const ImageSettings& img_settings,
-    const Camera& camera,
-    const FractalSettings& fractal_settings);
\ No newline at end of file
+    uint32_t num_procs,
+    const Settings& settings,
+    uint32_t threads,
+    const std::vector<uint32_t>& cpus,
+    const ReferenceOrbit* reference_orbit);
\ No newline at end of file
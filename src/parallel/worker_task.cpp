@@ -1,18 +1,131 @@
 #include "worker_task.h"
+#include "common/settings/image_settings.h"
+#include "common/settings/fractal_settings.h"
+#include "common/settings/camera.h"
 
 #include <cmath>
+#include <algorithm>
+
+/// @brief Twice the pixel coordinate of the axis, when it's an integer. Samples are
+/// centered on pixel coordinates, so pixels p and sum - p are then exact mirrors
+static bool get_axis_sum(double axis, int64_t& sum)
+{
+    double twice = 2.0 * axis;
+    if (!(fabs(twice) < 1e15))
+        return false;
+
+    sum = (int64_t)llround(twice);
+    return fabs(twice - (double)sum) <= SYMMETRY_AXIS_TOLERANCE;
+}
+
+/// @brief Pixels of one side of the axis whose mirror is in the image. The side is
+/// the one that leaves a contiguous range of rendered pixels
+static void get_mirrored_range(int64_t sum, uint32_t size, uint32_t& begin, uint32_t& end)
+{
+    begin = end = 0;
+    if (sum < 0 || sum > 2 * ((int64_t)size - 1))
+        return;
+
+    if (sum < (int64_t)size - 1) {
+        end = (sum + 1) / 2;
+    } else {
+        begin = sum / 2 + 1;
+        end = size;
+    }
+}
+
+/// @brief Blocks that are entirely within the pixel range
+static void get_block_range(uint32_t begin, uint32_t end, uint32_t size, uint32_t block_size, uint32_t& block_begin, uint32_t& block_end)
+{
+    block_begin = (begin + block_size - 1) / block_size;
+    block_end = end == size ? (size + block_size - 1) / block_size : end / block_size;
+    block_end = std::max(block_begin, block_end);
+}
+
+ImageSymmetry get_image_symmetry(
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t block_size)
+{
+    ImageSymmetry symmetry;
+
+    // Jittered adaptive samples aren't mirrored, and neither are the disks of distance
+    // fill, whose lattices start at the corner of each block, or the rectangles of
+    // subdivision, which start there too
+    if (!fractal_settings.symmetry || image_settings.adaptive_samples >= 4 || fractal_settings.distance_fill
+        || fractal_settings.subdivision)
+        return symmetry;
+
+    if (fractal_settings.type != FractalType::MANDELBROT && fractal_settings.type != FractalType::JULIA)
+        return symmetry;
+
+    // Pixel coordinates of the world axes, where pixel Y grows upwards
+    double zoom = (double)camera.zoom;
+    double axis_x = 0.5 * image_settings.width - (double)camera.x * zoom * image_settings.height;
+    double axis_y = image_settings.height * (0.5 - (double)camera.y * zoom);
+
+    int64_t pixel_y_sum;
+    if (!get_axis_sum(axis_y, pixel_y_sum))
+        return symmetry;
+
+    // Rows grow downwards from pixel Y height - 1
+    int64_t row_sum = 2 * ((int64_t)image_settings.height - 1) - pixel_y_sum;
+    uint32_t rows_begin, rows_end;
+    get_mirrored_range(row_sum, image_settings.height, rows_begin, rows_end);
+
+    // Every column of the mirrored rows of Mandelbrot mirrors itself. Julia columns
+    // only mirror when the other column is in the image
+    uint32_t columns_begin = 0, columns_end = image_settings.width;
+    int64_t column_sum = 0;
+    bool mirror_columns = fractal_settings.type == FractalType::JULIA;
+    if (mirror_columns) {
+        if (!get_axis_sum(axis_x, column_sum) || column_sum < 0 || column_sum > 2 * ((int64_t)image_settings.width - 1))
+            return symmetry;
+
+        columns_begin = std::max<int64_t>(0, column_sum - (image_settings.width - 1));
+        columns_end = std::min<int64_t>(image_settings.width - 1, column_sum) + 1;
+    }
+
+    symmetry.row_sum = row_sum;
+    symmetry.column_sum = column_sum;
+    symmetry.mirror_columns = mirror_columns;
+    get_block_range(rows_begin, rows_end, image_settings.height, block_size, symmetry.skipped_rows_begin, symmetry.skipped_rows_end);
+    get_block_range(columns_begin, columns_end, image_settings.width, block_size, symmetry.skipped_columns_begin, symmetry.skipped_columns_end);
+    return symmetry;
+}
 
 WorkerTask get_task_by_id(
     uint64_t id,
     uint32_t block_size,
     uint32_t img_width,
-    uint32_t img_height)
+    uint32_t img_height,
+    const ImageSymmetry& symmetry)
 {
     uint64_t x_tasks = (img_width + block_size - 1) / block_size;
 
-    // Reverse mapping from id to (x, y)
-    uint32_t id_x = id % x_tasks;
-    uint32_t id_y = id / x_tasks;
+    // Skips the ids of the blocks mirrored by the master. Rows before the skipped
+    // ones are complete, and the skipped ones lack the skipped columns
+    uint64_t skipped_columns = symmetry.skipped_columns_end - symmetry.skipped_columns_begin;
+    uint64_t partial_row_tasks = x_tasks - skipped_columns;
+    uint64_t partial_rows = symmetry.skipped_rows_end - symmetry.skipped_rows_begin;
+    uint64_t first_partial_id = symmetry.skipped_rows_begin * x_tasks;
+
+    uint32_t id_x, id_y;
+    if (id < first_partial_id || symmetry.num_skipped_tasks() == 0) {
+        id_x = id % x_tasks;
+        id_y = id / x_tasks;
+    } else if (id - first_partial_id < partial_rows * partial_row_tasks) {
+        uint64_t partial_id = id - first_partial_id;
+        id_x = partial_id % partial_row_tasks;
+        id_y = symmetry.skipped_rows_begin + partial_id / partial_row_tasks;
+        if (id_x >= symmetry.skipped_columns_begin)
+            id_x += skipped_columns;
+    } else {
+        uint64_t complete_id = id - first_partial_id - partial_rows * partial_row_tasks;
+        id_x = complete_id % x_tasks;
+        id_y = symmetry.skipped_rows_end + complete_id / x_tasks;
+    }
 
     uint32_t x = id_x * block_size;
     uint32_t y = id_y * block_size;
@@ -27,9 +140,10 @@ WorkerTask get_task_by_id(
 uint64_t get_num_tasks(
     uint32_t img_width,
     uint32_t img_height,
-    uint32_t block_size)
+    uint32_t block_size,
+    const ImageSymmetry& symmetry)
 {
     uint64_t x_tasks = (img_width + block_size - 1) / block_size;
     uint64_t y_tasks = (img_height + block_size - 1) / block_size;
-    return x_tasks * y_tasks;
-}
\ No newline at end of file
+    return x_tasks * y_tasks - symmetry.num_skipped_tasks();
+}
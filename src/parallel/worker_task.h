@@ -1,5 +1,10 @@
 #pragma once
 #include <stdint.h>
+#include <vector>
+
+struct ImageSettings;
+struct FractalSettings;
+class Camera;
 
 enum Tag {
     REQUEST,
@@ -8,18 +13,100 @@ enum Tag {
     TASK
 };
 
+/// @brief Tasks a threaded worker asks for per thread in each request. Requests carry
+/// the number of tasks, and tasks carry the first id and count of a run of consecutive
+/// tasks. Results are a single message, described in tile_codec.h, with that run, the
+/// number of tasks requested in its place and the encoded blocks
+#ifndef HYBRID_TASKS_PER_THREAD
+#define HYBRID_TASKS_PER_THREAD 4
+#endif
+
+/// @brief Guided scheduling sends a rank its share of the remaining tasks, by throughput,
+/// divided by this factor and by the requests it keeps in flight. Runs shrink as the
+/// image completes, down to the tasks the rank requests
+#ifndef GUIDED_CHUNK_DIVISOR
+#define GUIDED_CHUNK_DIVISOR 2
+#endif
+
+/// @brief Results a worker may have in transfer while it renders the next tasks
+#ifndef WORKER_RESULT_BUFFERS
+#define WORKER_RESULT_BUFFERS 3
+#endif
+
+/// @brief Results the master may be receiving at once, before it waits for one of them
+#ifndef MASTER_RESULT_BUFFERS
+#define MASTER_RESULT_BUFFERS 16
+#endif
+
 struct WorkerTask {
     uint32_t x, y;
     uint32_t width, height;
 };
 
+/// @brief The symmetry axis is only used when it's within this many pixels of a
+/// position where the samples of mirrored pixels match
+#ifndef SYMMETRY_AXIS_TOLERANCE
+#define SYMMETRY_AXIS_TOLERANCE 1e-6
+#endif
+
+/// @brief Blocks of the image whose pixels mirror rendered pixels, which aren't
+/// scheduled and are copied from their mirror by the master
+struct ImageSymmetry {
+
+    /// @brief Row r mirrors row row_sum - r. Julia also mirrors column c into
+    /// column column_sum - c, since its symmetry is about the origin
+    int64_t row_sum, column_sum;
+    bool mirror_columns;
+
+    /// @brief Ranges of block rows and columns that aren't scheduled
+    uint32_t skipped_rows_begin, skipped_rows_end;
+    uint32_t skipped_columns_begin, skipped_columns_end;
+
+    ImageSymmetry()
+        : row_sum(0)
+        , column_sum(0)
+        , mirror_columns(false)
+        , skipped_rows_begin(0)
+        , skipped_rows_end(0)
+        , skipped_columns_begin(0)
+        , skipped_columns_end(0)
+    {
+    }
+
+    uint64_t num_skipped_tasks() const
+    {
+        return (uint64_t)(skipped_rows_end - skipped_rows_begin) * (skipped_columns_end - skipped_columns_begin);
+    }
+};
+
+/// @brief Symmetric blocks of the view. None are skipped when the axis isn't in view,
+/// isn't aligned with the samples of the pixels, or symmetry is disabled
+ImageSymmetry get_image_symmetry(
+    const ImageSettings& image_settings,
+    const FractalSettings& fractal_settings,
+    const Camera& camera,
+    uint32_t block_size);
+
+/// @brief Order in which the tasks are dispatched. Tasks are sent as runs of consecutive
+/// positions of the order, which are the task ids in raster order unless task_ids is set
+struct TaskSchedule {
+    std::vector<uint64_t> task_ids;
+
+    uint64_t get_task_id(uint64_t position) const
+    {
+        return task_ids.empty() ? position : task_ids[position];
+    }
+};
+
 WorkerTask get_task_by_id(
     uint64_t id,
     uint32_t block_size,
     uint32_t img_width,
-    uint32_t img_height);
+    uint32_t img_height,
+    const ImageSymmetry& symmetry);
 
 uint64_t get_num_tasks(
     uint32_t img_width,
     uint32_t img_height,
-    uint32_t block_size);
\ No newline at end of file
+    uint32_t block_size,
+    const ImageSymmetry& symmetry);
@@ -0,0 +1,91 @@
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "common/common.h"
+#include "common/palette.h"
+#include "common/field_file.h"
+#include "common/output_handler.h"
+#include "common/logging.h"
+
+static void print_usage()
+{
+    LOG("Colors a field saved with --output_field, without rendering it again");
+    LOG("Usage: recolor <field file> [options]");
+    LOG("  --color_mode, --gradient, -od, -on and --quiet work as in the renderer");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argv[1][0] == '-') {
+        print_usage();
+        return 0;
+    }
+
+    // The field takes the place of the executable name, so the options are parsed
+    // by the renderer's parser
+    Settings settings;
+    if (!load_args(argc - 1, argv + 1, settings))
+        return 0;
+
+    std::chrono::time_point start = std::chrono::high_resolution_clock::now();
+
+    FieldFile field_file;
+    if (!field_file.open(argv[1]))
+        return 1;
+
+    const FieldFileHeader& header = field_file.get_header();
+    const uint32_t tile_size = header.tile_size;
+    const uint32_t samples_per_pixel = header.samples_per_pixel;
+    const uint32_t tile_values = tile_size * tile_size * samples_per_pixel;
+    LOG_STATUS("Coloring " << header.width << "x" << header.height << " field with " << samples_per_pixel << " samples per pixel");
+
+    Palette palette(settings.fractal);
+    std::vector<uint8_t> image((uint64_t)header.width * header.height * 3);
+    std::vector<float> r(tile_values), g(tile_values), b(tile_values);
+
+    // Tiles are colored in a single lookup pass, then their samples are averaged
+    for (uint32_t tile_y = 0; tile_y < header.tiles_y; ++tile_y) {
+        for (uint32_t tile_x = 0; tile_x < header.tiles_x; ++tile_x) {
+            palette.color(field_file.get_tile(tile_x, tile_y), r.data(), g.data(), b.data(), tile_values);
+
+            uint32_t width = std::min(tile_size, header.width - tile_x * tile_size);
+            uint32_t height = std::min(tile_size, header.height - tile_y * tile_size);
+            for (uint32_t j = 0; j < height; ++j) {
+                for (uint32_t i = 0; i < width; ++i) {
+                    uint32_t first = (j * tile_size + i) * samples_per_pixel;
+                    float pixel_r = 0.0f, pixel_g = 0.0f, pixel_b = 0.0f;
+
+                    for (uint32_t s = first; s < first + samples_per_pixel; ++s) {
+                        pixel_r += r[s];
+                        pixel_g += g[s];
+                        pixel_b += b[s];
+                    }
+
+                    uint64_t idx = ((uint64_t)(tile_y * tile_size + j) * header.width + tile_x * tile_size + i) * 3;
+                    image[idx] = pixel_r / samples_per_pixel * 255;
+                    image[idx + 1] = pixel_g / samples_per_pixel * 255;
+                    image[idx + 2] = pixel_b / samples_per_pixel * 255;
+                }
+            }
+        }
+    }
+
+    std::chrono::time_point end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    LOG_STATUS("Coloring took: " << duration.count() << " ms");
+
+    std::shared_ptr<OutputHandler> output_handler = OutputHandler::factory_create(settings.output_settings.mode);
+
+    bool success = output_handler->save_output(
+        image.data(),
+        header.width,
+        header.height,
+        settings.output_settings);
+
+    if (!success) {
+        LOG_ERROR("Unable to output image...");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+"""
+Precision benchmark times the same render with sequential executables built with
+different number types, for example MPFR against fixed point at the same precision:
+
+    cmake -B build_mpfr -DUSE_DYNAMIC_PRECISION=ON ...
+    cmake -B build_fixed -DUSE_PRECISION_FIXED_POINT=ON -DFIXED_POINT_LIMBS=5 ...
+
+    python3 ./precision_benchmark.py \\
+        mpfr=../../build_mpfr/sequential \\
+        fixed=../../build_fixed/sequential
+
+The first executable is the baseline for the reported speedups
+"""
+import argparse
+import os
+import statistics
+import subprocess
+import tempfile
+import time
+
+# Deep zoom around a spiral, past the precision of double
+DEFAULT_CAMERA_X = "-0.743643887037158704752191506114774"
+DEFAULT_CAMERA_Y = "0.131825904205311970493132056385139"
+DEFAULT_ZOOM = "1e28"
+
+
+def time_render(executable, render_args, output_path):
+    command = [executable, "--quiet"] + render_args + ["-od", output_path]
+    start = time.perf_counter()
+    subprocess.run(command, check=True, capture_output=True)
+    return time.perf_counter() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Times renders of several fractal builds")
+    parser.add_argument("executables", nargs="+", help="label=path of each sequential executable")
+    parser.add_argument("--width", type=int, default=200)
+    parser.add_argument("--height", type=int, default=150)
+    parser.add_argument("--iterations", type=int, default=2000)
+    parser.add_argument("--camera_x", default=DEFAULT_CAMERA_X)
+    parser.add_argument("--camera_y", default=DEFAULT_CAMERA_Y)
+    parser.add_argument("--zoom", default=DEFAULT_ZOOM)
+    parser.add_argument("--repeats", type=int, default=3, help="Renders per executable, the median is reported")
+    args = parser.parse_args()
+
+    render_args = [
+        "-w", str(args.width),
+        "-h", str(args.height),
+        "-i", str(args.iterations),
+        "-cx", args.camera_x,
+        "-cy", args.camera_y,
+        "-z", args.zoom,
+    ]
+
+    results = []
+    with tempfile.TemporaryDirectory() as output_dir:
+        for entry in args.executables:
+            label, _, path = entry.partition("=")
+            if not path:
+                label, path = os.path.basename(entry), entry
+
+            output_path = os.path.join(output_dir, f"{len(results)}.png")
+            times = [time_render(path, render_args, output_path) for _ in range(args.repeats)]
+            results.append((label, statistics.median(times)))
+
+    baseline = results[0][1]
+    print(f"{'build':<16}{'median (s)':>12}{'speedup':>10}")
+    for label, seconds in results:
+        print(f"{label:<16}{seconds:>12.3f}{baseline / seconds:>9.2f}x")
+
+
+if __name__ == "__main__":
+    main()
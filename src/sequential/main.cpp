@@ -1,10 +1,13 @@
 #include <stdint.h>
 #include <chrono>
 #include "common/common.h"
-#include "common/renderer.h"
+#include "common/tile_renderer.h"
 #include <memory>
 #include "common/output_handler.h"
 #include "common/logging.h"
+#include "common/simd.h"
+#include "common/field_file.h"
+#include <vector>
 
 int main(int argc, char** argv)
 {
@@ -16,13 +19,62 @@ int main(int argc, char** argv)
     if (!run_program) {
         return 0;
     }
-    LOG_STATUS("Running...");
+    LOG_STATUS("Running with " << get_simd_level_name(get_simd_level()) << " kernels...");
 
     std::chrono::time_point start = std::chrono::high_resolution_clock::now();
 
+    // Tiles of the block size are spread over the cores
+    ThreadPool pool(settings.threads);
+    LOG_STATUS("Rendering with " << pool.get_thread_count() << " threads");
+
+    ReferenceOrbit reference_orbit;
+    if (settings.fractal.perturbation)
+        compute_reference_orbit(settings.camera, settings.fractal, reference_orbit);
+
+    // Fields keep the values of the samples, which recolor turns into images
+    if (settings.output_settings.mode == OutputSettingsMode::FIELD) {
+        uint32_t samples_per_pixel = settings.image.multi_sample_anti_aliasing;
+        std::vector<float> field((uint64_t)settings.image.width * settings.image.height * samples_per_pixel);
+        render_block_field_tiles(
+            pool,
+            settings.block_size,
+            field.data(),
+            settings.image,
+            settings.fractal,
+            settings.camera,
+            0,
+            0,
+            settings.image.width,
+            settings.image.height,
+            settings.fractal.perturbation ? &reference_orbit : nullptr);
+
+        std::chrono::time_point end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        LOG_STATUS("Computation took: " << duration.count() << " ms");
+
+        FieldFile field_file;
+        if (!field_file.create(
+                settings.output_settings.disk_data.output_path,
+                settings.image.width,
+                settings.image.height,
+                samples_per_pixel,
+                settings.block_size,
+                settings.fractal.max_iterations)) {
+            LOG_ERROR("Unable to output field...");
+            return 0;
+        }
+
+        field_file.write_block(field.data(), 0, 0, settings.image.width, settings.image.height);
+        return 0;
+    }
+
+    Palette palette(settings.fractal);
+
     uint32_t buffer_length = settings.image.width * settings.image.height * 3;
     uint8_t* buffer = new uint8_t[buffer_length];
-    render_block(
+    render_block_tiles(
+        pool,
+        settings.block_size,
         buffer,
         settings.image,
         settings.fractal,
@@ -30,7 +82,9 @@ int main(int argc, char** argv)
         0,
         0,
         settings.image.width,
-        settings.image.height);
+        settings.image.height,
+        palette,
+        settings.fractal.perturbation ? &reference_orbit : nullptr);
 
     std::chrono::time_point end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);